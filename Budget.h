@@ -0,0 +1,58 @@
+#pragma once
+
+// Limits work by wall-clock time and by number of evaluations, whichever runs out first.
+// A zero limit means no limit. Safe to spend from multiple threads.
+
+#include <algorithm> // min
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+class Budget
+{
+    using Clock = std::chrono::steady_clock;
+public:
+    // seconds beyond max_seconds would overflow the deadline, and are taken as no limit.
+    Budget(double seconds, size_t evaluations)
+        : m_timed(seconds > 0 and seconds <= max_seconds)
+        , m_deadline(Clock::now() + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(std::min(seconds, max_seconds))))
+        , m_evaluations(evaluations > 0 ? evaluations : std::numeric_limits<size_t>::max()) {}
+
+    // Returns true and uses one evaluation if any budget remains.
+    bool spend()
+    {
+        if (timed_out())
+        {
+            m_evaluations = 0;
+            return false;
+        }
+        auto evaluations {m_evaluations.load()};
+        while (evaluations > 0)
+        {
+            if (m_evaluations.compare_exchange_weak(evaluations, evaluations - 1))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool exhausted() const
+    {
+        return m_evaluations == 0 or timed_out();
+    }
+
+    // for stopping an evaluation in progress.
+    bool timed_out() const
+    {
+        return m_timed and Clock::now() >= m_deadline;
+    }
+
+private:
+    static constexpr double max_seconds {1e9}; // about 30 years.
+
+    const bool m_timed {false};
+    const Clock::time_point m_deadline;
+    std::atomic<size_t> m_evaluations {0};
+};
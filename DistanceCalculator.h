@@ -1,35 +1,168 @@
 #pragma once
 
+// Lengths between points under a TSPLIB edge weight type, given as a policy from metric.h.
+// The policy is fixed at compile time so that length computations in the search loops are inlined;
+//  v-opt dispatches on the EDGE_WEIGHT_TYPE of the point set once, at startup.
+// Lengths are cached if the policy is a metric::Cached one, with hit statistics to tell whether it pays off.
+// Caches are filled by compute_length, which is called from several search threads at once,
+//  so entries are relaxed atomics, and hits and misses are counted per thread.
+
+#include "metric.h"
 #include "primitives.h"
 
 #include <algorithm> // min, max
-#include <cmath> // sqrt
+#include <array>
+#include <atomic>
+#include <cstdint> // uint64_t
 #include <vector>
 
+namespace distance_cache {
+
+// threads beyond this share counters, and may lose counts.
+constexpr size_t max_threads {64};
+
+// counter slot of the calling thread.
+inline size_t thread_slot()
+{
+    static std::atomic<size_t> next_slot {0};
+    thread_local const size_t slot {next_slot++ % max_threads};
+    return slot;
+}
+
+} // namespace distance_cache
+
+template <typename Metric>
 class DistanceCalculator
 {
 public:
-    DistanceCalculator(const std::vector<primitives::space_t>& x, const std::vector<primitives::space_t>& y)
-        : m_x(x), m_y(y) {}
+    static constexpr metric::DistanceCache cache {metric::cache<Metric>};
+
+    // hashed_entries: rounded up to a power of two; only for metric::DistanceCache::hashed.
+    DistanceCalculator(const std::vector<primitives::coordinate_t>& x, const std::vector<primitives::coordinate_t>& y
+        , size_t hashed_entries = 0)
+        : m_x(x), m_y(y)
+        , m_table(cache == metric::DistanceCache::table ? x.size() * (x.size() - 1) / 2 : 0)
+    {
+        if (cache == metric::DistanceCache::hashed)
+        {
+            size_t entries {2};
+            while (entries < hashed_entries)
+            {
+                entries <<= 1;
+                --m_hash_shift;
+            }
+            m_hashed = std::vector<HashedEntry>(entries);
+        }
+    }
 
     primitives::length_t compute_length(primitives::point_id_t a, primitives::point_id_t b) const
     {
-        return compute_euc2d(a, b);
+        if constexpr (cache == metric::DistanceCache::table)
+        {
+            return table_length(a, b);
+        }
+        else if constexpr (cache == metric::DistanceCache::hashed)
+        {
+            return hashed_length(a, b);
+        }
+        else
+        {
+            return Metric::length(x(a), y(a), x(b), y(b));
+        }
+    }
+
+    // squared coordinate distance; compared to Metric::squared_bound to reject lengths without a sqrt.
+    double compute_squared(primitives::point_id_t a, primitives::point_id_t b) const
+    {
+        auto dx = x(a) - x(b);
+        auto dy = y(a) - y(b);
+        return dx * dx + dy * dy;
     }
 
-    const primitives::space_t& x(primitives::point_id_t i) const { return m_x[i]; }
-    const primitives::space_t& y(primitives::point_id_t i) const { return m_y[i]; }
+    primitives::space_t x(primitives::point_id_t i) const { return primitives::to_space(m_x[i]); }
+    primitives::space_t y(primitives::point_id_t i) const { return primitives::to_space(m_y[i]); }
+    const std::vector<primitives::coordinate_t>& x() const { return m_x; }
+    const std::vector<primitives::coordinate_t>& y() const { return m_y; }
+
+    // cached lengths found (hits) and computed (misses) by compute_length, summed over threads.
+    uint64_t hits() const { return sum(&Counts::hits); }
+    uint64_t misses() const { return sum(&Counts::misses); }
 
 private:
-    const std::vector<primitives::space_t>& m_x;
-    const std::vector<primitives::space_t>& m_y;
-    std::vector<std::vector<primitives::length_t>> m_table;
+    // check holds the pair key xor length, so that an entry torn by concurrent writes reads as a miss.
+    struct HashedEntry
+    {
+        std::atomic<uint64_t> check;
+        std::atomic<primitives::length_t> length;
+    };
+    // one cache line per thread slot, so that threads do not contend on counting.
+    struct alignas(64) Counts
+    {
+        std::atomic<uint64_t> hits {0};
+        std::atomic<uint64_t> misses {0};
+    };
+
+    const std::vector<primitives::coordinate_t>& m_x;
+    const std::vector<primitives::coordinate_t>& m_y;
+    // length + 1 for the pair at index (max * (max - 1) / 2 + min); 0 if not computed yet.
+    mutable std::vector<std::atomic<primitives::length_t>> m_table;
+    mutable std::vector<HashedEntry> m_hashed; // zero entries read as the pair (0, 0) of length 0.
+    int m_hash_shift {63};
+    mutable std::array<Counts, distance_cache::max_threads> m_counts;
+
+    // only the thread of a slot writes it, unless there are more threads than slots.
+    static void count(std::atomic<uint64_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    uint64_t sum(std::atomic<uint64_t> Counts::* counter) const
+    {
+        uint64_t total {0};
+        for (const auto& counts : m_counts)
+        {
+            total += (counts.*counter).load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    primitives::length_t table_length(primitives::point_id_t a, primitives::point_id_t b) const
+    {
+        if (a == b)
+        {
+            return 0;
+        }
+        const uint64_t max {std::max(a, b)};
+        auto& entry {m_table[max * (max - 1) / 2 + std::min(a, b)]};
+        auto& counts {m_counts[distance_cache::thread_slot()]};
+        const auto cached {entry.load(std::memory_order_relaxed)};
+        if (cached != 0)
+        {
+            count(counts.hits);
+            return cached - 1;
+        }
+        count(counts.misses);
+        const auto length {Metric::length(x(a), y(a), x(b), y(b))};
+        entry.store(length + 1, std::memory_order_relaxed);
+        return length;
+    }
 
-    primitives::length_t compute_euc2d(primitives::point_id_t a, primitives::point_id_t b) const
+    primitives::length_t hashed_length(primitives::point_id_t a, primitives::point_id_t b) const
     {
-        auto dx = m_x[a] - m_x[b];
-        auto dy = m_y[a] - m_y[b];
-        auto exact = std::sqrt(dx * dx + dy * dy);
-        return exact + 0.5; // return type cast.
+        const auto key {static_cast<uint64_t>(std::max(a, b)) << 32 | std::min(a, b)};
+        // Fibonacci hashing: the top bits of the product.
+        auto& entry {m_hashed[(key * 0x9E3779B97F4A7C15ull) >> m_hash_shift]};
+        auto& counts {m_counts[distance_cache::thread_slot()]};
+        const auto cached {entry.length.load(std::memory_order_relaxed)};
+        if ((entry.check.load(std::memory_order_relaxed) ^ cached) == key)
+        {
+            count(counts.hits);
+            return cached;
+        }
+        count(counts.misses);
+        const auto length {Metric::length(x(a), y(a), x(b), y(b))};
+        entry.length.store(length, std::memory_order_relaxed);
+        entry.check.store(key ^ length, std::memory_order_relaxed);
+        return length;
     }
 };
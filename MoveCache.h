@@ -0,0 +1,81 @@
+#pragma once
+
+// Caches the best known VMove of every point, queued by improvement.
+// Queued moves are invalidated lazily: a popped move is only returned
+//  if it is still the cached move of its point.
+// Once more than half of the queue is stale, it is rebuilt from the cached moves,
+//  so that its size stays within twice the point count.
+
+#include "VMove.h"
+#include "primitives.h"
+
+#include <queue>
+#include <utility> // move
+#include <vector>
+
+class MoveCache
+{
+public:
+    MoveCache(size_t point_count) : m_moves(point_count) {}
+
+    const VMove& move(primitives::point_id_t i) const { return m_moves[i]; }
+
+    void update(primitives::point_id_t i, const VMove& move)
+    {
+        if (move == m_moves[i])
+        {
+            return;
+        }
+        if (m_moves[i].improvement > 0)
+        {
+            --m_live;
+        }
+        m_moves[i] = move;
+        if (move.improvement > 0)
+        {
+            ++m_live;
+            m_queue.push(move);
+            if (m_queue.size() > m_moves.size() and m_queue.size() - m_live > m_queue.size() / 2)
+            {
+                rebuild();
+            }
+        }
+    }
+
+    // Returns the cached move with the greatest improvement, or an empty move if there are none.
+    // The returned move is removed from the cache, so its point needs to be updated again.
+    VMove pop()
+    {
+        while (not m_queue.empty())
+        {
+            const auto move {m_queue.top()};
+            m_queue.pop();
+            if (move == m_moves[move.i])
+            {
+                m_moves[move.i] = {};
+                --m_live;
+                return move;
+            }
+        }
+        return {};
+    }
+
+private:
+    std::vector<VMove> m_moves; // index corresponds to point id.
+    std::priority_queue<VMove, std::vector<VMove>, VMove::Compare> m_queue;
+    size_t m_live {0}; // cached moves with an improvement, each of which is queued.
+
+    void rebuild()
+    {
+        std::vector<VMove> live;
+        live.reserve(m_live);
+        for (const auto& move : m_moves)
+        {
+            if (move.improvement > 0)
+            {
+                live.push_back(move);
+            }
+        }
+        m_queue = decltype(m_queue)(VMove::Compare(), std::move(live));
+    }
+};
@@ -7,7 +7,8 @@
 struct Segment
 {
     Segment() = default;
-    Segment(primitives::point_id_t a, primitives::point_id_t b, const DistanceCalculator& dc)
+    template <typename Metric>
+    Segment(primitives::point_id_t a, primitives::point_id_t b, const DistanceCalculator<Metric>& dc)
         : min(std::min(a, b)), max(std::max(a, b)), length(dc.compute_length(a, b)) {}
     primitives::point_id_t min {constants::invalid_point};
     primitives::point_id_t max {constants::invalid_point};
@@ -0,0 +1,128 @@
+#pragma once
+
+// Persistent worker threads that run a function over contiguous chunks of an index range.
+// The calling thread takes part in the work, so a pool of size 1 has no worker threads.
+
+#include <algorithm> // min
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    ThreadPool(size_t thread_count)
+    {
+        for (size_t t {1}; t < thread_count; ++t)
+        {
+            m_workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return m_workers.size() + 1; }
+
+    // Number of chunks that for_each_chunk splits count indices into.
+    size_t chunk_count(size_t count) const
+    {
+        constexpr size_t ChunksPerThread {8}; // more chunks than threads balances uneven work.
+        return std::min(count, size() * ChunksPerThread);
+    }
+
+    // Calls f(begin, end, chunk) for every chunk of [0, count) and blocks until all have returned.
+    // Chunks are ordered by index, so per-chunk results can be reduced in serial order.
+    template <typename Function>
+    void for_each_chunk(size_t count, const Function& f)
+    {
+        const auto chunks {chunk_count(count)};
+        auto run_chunk = [&f, count, chunks](size_t chunk)
+        {
+            f(count * chunk / chunks, count * (chunk + 1) / chunks, chunk);
+        };
+        if (m_workers.empty() or chunks < 2)
+        {
+            for (size_t chunk {0}; chunk < chunks; ++chunk)
+            {
+                run_chunk(chunk);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = run_chunk;
+            m_chunks = chunks;
+            m_next_chunk = 0;
+            m_busy = m_workers.size();
+            ++m_generation;
+        }
+        m_start.notify_all();
+        run_chunks();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_busy == 0; });
+        m_job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+
+    std::function<void(size_t)> m_job;
+    size_t m_chunks {0};
+    std::atomic<size_t> m_next_chunk {0};
+    size_t m_busy {0}; // workers that have not finished the current job.
+    size_t m_generation {0}; // incremented for every job.
+    bool m_stop {false};
+
+    void run_chunks()
+    {
+        for (auto chunk {m_next_chunk++}; chunk < m_chunks; chunk = m_next_chunk++)
+        {
+            m_job(chunk);
+        }
+    }
+
+    void work()
+    {
+        size_t generation {0};
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [this, generation] { return m_stop or m_generation != generation; });
+                if (m_stop)
+                {
+                    return;
+                }
+                generation = m_generation;
+            }
+            run_chunks();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_busy;
+            }
+            m_done.notify_one();
+        }
+    }
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+// Keeps the K moves with the greatest improvement seen so far, in a bounded min-heap.
+// Ties are broken by point ids, so the kept moves do not depend on the order they are pushed in.
+
+#include "VMove.h"
+
+#include <algorithm> // push_heap, pop_heap, sort_heap
+#include <tuple>
+#include <vector>
+
+class TopMoves
+{
+public:
+    TopMoves(size_t capacity) : m_capacity(capacity) { m_moves.reserve(capacity); }
+
+    size_t size() const { return m_moves.size(); }
+    size_t pushed() const { return m_pushed; }
+
+    void push(const VMove& move)
+    {
+        ++m_pushed;
+        if (m_moves.size() < m_capacity)
+        {
+            m_moves.push_back(move);
+            std::push_heap(std::begin(m_moves), std::end(m_moves), better);
+            return;
+        }
+        if (m_capacity == 0 or not better(move, m_moves.front()))
+        {
+            return;
+        }
+        std::pop_heap(std::begin(m_moves), std::end(m_moves), better);
+        m_moves.back() = move;
+        std::push_heap(std::begin(m_moves), std::end(m_moves), better);
+    }
+
+    // Returns the kept moves, best first, and empties this.
+    std::vector<VMove> take()
+    {
+        std::sort_heap(std::begin(m_moves), std::end(m_moves), better);
+        auto moves {std::move(m_moves)};
+        m_moves.clear();
+        m_pushed = 0;
+        return moves;
+    }
+
+private:
+    const size_t m_capacity {0};
+    size_t m_pushed {0}; // total moves offered.
+    std::vector<VMove> m_moves; // min-heap: the worst kept move is at front.
+
+    static bool better(const VMove& lhs, const VMove& rhs)
+    {
+        return std::make_tuple(lhs.improvement, rhs.i, rhs.j) > std::make_tuple(rhs.improvement, lhs.i, lhs.j);
+    }
+};
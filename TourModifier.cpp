@@ -9,17 +9,23 @@ TourModifier::TourModifier(const std::vector<primitives::point_id_t>& initial_to
 
 void TourModifier::move(const VMove& move)
 {
-    const auto old_adjacents {m_adjacents[move.i]};
-    break_adjacency(move.i, m_adjacents[move.i][0]);
-    break_adjacency(move.i, m_adjacents[move.i][1]);
-    break_adjacency(move.j, m_next[move.j]);
+    // i is spliced out from between its adjacents and back in between j and next[j].
+    const auto prev {this->prev(move.i)};
+    const auto old_next {m_next[move.i]};
+    const auto j_next {m_next[move.j]};
+    break_adjacency(move.i, prev);
+    break_adjacency(move.i, old_next);
+    break_adjacency(move.j, j_next);
     create_adjacency(move.i, move.j);
-    create_adjacency(move.i, m_next[move.j]);
-    create_adjacency(old_adjacents[0], old_adjacents[1]);
-    update_next();
+    create_adjacency(move.i, j_next);
+    create_adjacency(prev, old_next);
+    m_next[prev] = old_next;
+    m_next[move.j] = move.i;
+    m_next[move.i] = j_next;
 }
 
-primitives::length_t TourModifier::current_length(const DistanceCalculator& dc) const
+template <typename Metric>
+primitives::length_t TourModifier::current_length(const DistanceCalculator<Metric>& dc) const
 {
     primitives::point_id_t current {0};
     constexpr primitives::point_id_t start {0};
@@ -46,9 +52,9 @@ void TourModifier::initialize(const std::vector<primitives::point_id_t>& initial
     for (auto p : initial_tour)
     {
         create_adjacency(p, prev);
+        m_next[prev] = p;
         prev = p;
     }
-    update_next();
 }
 
 std::vector<primitives::point_id_t> TourModifier::current_tour() const
@@ -56,9 +62,14 @@ std::vector<primitives::point_id_t> TourModifier::current_tour() const
     std::vector<primitives::point_id_t> points(m_next.size(), constants::invalid_point);
     constexpr primitives::point_id_t start_point{0};
     primitives::point_id_t i{start_point};
-    int sequence{0};
+    size_t sequence{0};
     do
     {
+        if (sequence == points.size())
+        {
+            std::cout << __func__ << ": error: next does not return to the start point." << std::endl;
+            std::abort();
+        }
         points[sequence] = i;
         i = m_next[i];
         ++sequence;
@@ -66,18 +77,6 @@ std::vector<primitives::point_id_t> TourModifier::current_tour() const
     return points;
 }
 
-void TourModifier::update_next()
-{
-    primitives::point_id_t current{0};
-    m_next[current] = m_adjacents[current].front();
-    do
-    {
-        auto prev = current;
-        current = m_next[current];
-        m_next[current] = get_other(current, prev);
-    } while (current != 0); // tour cycle condition.
-}
-
 primitives::point_id_t TourModifier::get_other(primitives::point_id_t point, primitives::point_id_t adjacent) const
 {
     const auto& a = m_adjacents[point];
@@ -107,21 +106,38 @@ void TourModifier::fill_adjacent(primitives::point_id_t point, primitives::point
     {
         m_adjacents[point].back() = new_adjacent;
     }
+    else
+    {
+        std::cout << __func__ << ": error: failed to assign adjacency." << std::endl;
+        std::abort();
+    }
 }
 
 void TourModifier::break_adjacency(primitives::point_id_t point1, primitives::point_id_t point2)
 {
-    vacate_adjacent_slot(point1, point2, 0);
-    vacate_adjacent_slot(point1, point2, 1);
-    vacate_adjacent_slot(point2, point1, 0);
-    vacate_adjacent_slot(point2, point1, 1);
+    vacate_adjacent_slot(point1, point2);
+    vacate_adjacent_slot(point2, point1);
 }
 
-void TourModifier::vacate_adjacent_slot(primitives::point_id_t point, primitives::point_id_t adjacent, int slot)
+void TourModifier::vacate_adjacent_slot(primitives::point_id_t point, primitives::point_id_t adjacent)
 {
-    if (m_adjacents[point][slot] == adjacent)
+    if (m_adjacents[point][0] == adjacent)
+    {
+        m_adjacents[point][0] = constants::invalid_point;
+    }
+    else if (m_adjacents[point][1] == adjacent)
+    {
+        m_adjacents[point][1] = constants::invalid_point;
+    }
+    else
     {
-        m_adjacents[point][slot] = constants::invalid_point;
+        std::cout << __func__ << ": error: attempted to remove non-existent adjacency." << std::endl;
+        std::abort();
     }
 }
 
+// for every metric policy.
+#define TOUR_MODIFIER_INSTANTIATE(Metric) \
+    template primitives::length_t TourModifier::current_length(const DistanceCalculator<Metric>&) const;
+METRIC_FOR_EACH_POLICY(TOUR_MODIFIER_INSTANTIATE)
+#undef TOUR_MODIFIER_INSTANTIATE
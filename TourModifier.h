@@ -1,5 +1,10 @@
 #pragma once
 
+// Tour as a doubly-linked cycle: adjacents holds both neighbors of every point
+//  and next fixes a traversal direction, so next and prev are O(1) queries.
+// A VMove only splices a single point out and back in, so it never reverses
+//  any part of the tour and is applied in O(1).
+
 #include "Connection.h"
 #include "DistanceCalculator.h"
 #include "constants.h"
@@ -21,9 +26,11 @@ public:
     void initialize(const std::vector<primitives::point_id_t>& initial_tour);
     std::vector<primitives::point_id_t> current_tour() const;
     primitives::point_id_t next(primitives::point_id_t i) const { return m_next[i]; }
+    primitives::point_id_t prev(primitives::point_id_t i) const { return get_other(i, m_next[i]); }
     const std::vector<primitives::point_id_t>& next() const { return m_next; }
 
-    primitives::length_t current_length(const DistanceCalculator& dc) const;
+    template <typename Metric>
+    primitives::length_t current_length(const DistanceCalculator<Metric>& dc) const;
     const std::vector<Adjacents>& adjacents() const { return m_adjacents; }
     void move(const VMove&);
 
@@ -31,13 +38,11 @@ private:
     std::vector<Adjacents> m_adjacents;
     std::vector<primitives::point_id_t> m_next;
 
-    void update_next();
-
     primitives::point_id_t get_other(primitives::point_id_t point, primitives::point_id_t adjacent) const;
     void create_adjacency(const Connection& c);
     void create_adjacency(primitives::point_id_t point1, primitives::point_id_t point2);
     void fill_adjacent(primitives::point_id_t point, primitives::point_id_t new_adjacent);
     void break_adjacency(const Connection& c);
     void break_adjacency(primitives::point_id_t point1, primitives::point_id_t point2);
-    void vacate_adjacent_slot(primitives::point_id_t point, primitives::point_id_t adjacent, int slot);
+    void vacate_adjacent_slot(primitives::point_id_t point, primitives::point_id_t adjacent);
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+// State of a tour that is being improved, kept consistent by solver::apply_move.
+// While journal is set, the inverse of every applied move is appended to undo_log,
+//  so that solver::rollback can restore the state in time proportional to the moves made.
+// While quiet is set, hill climbing on the state prints nothing, as for perturbation workers,
+//  whose output would otherwise interleave.
+
+#include "DistanceCalculator.h"
+#include "TourModifier.h"
+#include "VMove.h"
+#include "point_quadtree/Quadtree.h"
+#include "point_quadtree/SegmentState.h"
+#include "primitives.h"
+#include "tour.h"
+
+#include <array>
+#include <vector>
+
+struct TourState
+{
+    template <typename Metric>
+    TourState(const std::vector<primitives::point_id_t>& ordered_points
+        , const point_quadtree::Quadtree<Metric>& quadtree
+        , const DistanceCalculator<Metric>& dc)
+        : tour_modifier(ordered_points)
+        , segment_state(quadtree.size())
+        , segment_lengths(tour::compute_adjacent_lengths(tour_modifier.adjacents(), dc))
+        , next_lengths(tour::compute_next_lengths(tour_modifier.next(), dc))
+        , length(tour::compute_length(ordered_points, dc))
+    {
+        for (const auto& s : tour::compute_segments(tour_modifier.next(), dc))
+        {
+            quadtree.add_segment(s, segment_state);
+        }
+    }
+
+    TourModifier tour_modifier;
+    point_quadtree::SegmentState segment_state;
+    std::vector<std::array<primitives::length_t, 2>> segment_lengths; // adjacent segment lengths of each point.
+    std::vector<primitives::length_t> next_lengths;
+    primitives::length_t length {0};
+
+    bool journal {false};
+    bool quiet {false};
+    std::vector<VMove> undo_log;
+};
@@ -24,5 +24,19 @@ struct VMove
             improvement = other.improvement;
         }
     }
+
+    // For use in priority_queue (max-heap on improvement).
+    struct Compare
+    {
+        bool operator()(const VMove& lhs, const VMove& rhs) const
+        {
+            return lhs.improvement < rhs.improvement;
+        }
+    };
 };
 
+inline bool operator==(const VMove& lhs, const VMove& rhs)
+{
+    return lhs.i == rhs.i and lhs.j == rhs.j and lhs.improvement == rhs.improvement;
+}
+
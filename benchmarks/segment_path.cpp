@@ -0,0 +1,115 @@
+// Micro-benchmark of segment insertion paths: morton_keys::segment_insertion_path against the
+//  std::vector path it replaced, on segments between nearby random points.
+// Build and run with "make bench"; prints ns per path built and walked for both.
+
+#include <point_quadtree/morton_keys.h>
+
+#include <algorithm> // sort
+#include <chrono>
+#include <cstdlib> // abort, strtoul
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// The path as it was built before SegmentPath: one quadrant per depth below the root.
+std::vector<primitives::quadrant_t> vector_insertion_path(primitives::morton_key_t key1, primitives::morton_key_t key2)
+{
+    constexpr primitives::morton_key_t quadrant_mask {static_cast<primitives::morton_key_t>(3)};
+    std::vector<primitives::quadrant_t> path;
+    for (int i {1}; i < constants::max_tree_depth; ++i)
+    {
+        const int bit_shift {2 * (constants::max_tree_depth - 1 - i)};
+        const auto level1 {key1 >> bit_shift};
+        if (level1 != key2 >> bit_shift)
+        {
+            break;
+        }
+        path.push_back(static_cast<primitives::quadrant_t>(level1 & quadrant_mask));
+    }
+    return path;
+}
+
+template <typename Walk>
+double time_paths(const std::vector<std::pair<primitives::morton_key_t, primitives::morton_key_t>>& segments
+    , size_t repeats, size_t& checksum, const Walk& walk)
+{
+    const auto start {std::chrono::steady_clock::now()};
+    for (size_t r {0}; r < repeats; ++r)
+    {
+        for (const auto& [key1, key2] : segments)
+        {
+            checksum += walk(key1, key2);
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed {std::chrono::steady_clock::now() - start};
+    return elapsed.count() / static_cast<double>(repeats * segments.size());
+}
+
+} // namespace
+
+int main(int argc, const char** argv)
+{
+    const size_t point_count {argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 20};
+    const size_t repeats {argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 6};
+
+    // segments from every point to one of the next 16 points in key order, as in a good tour.
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<double> coordinate(0, 1);
+    std::vector<primitives::morton_key_t> keys(point_count);
+    for (auto& key : keys)
+    {
+        key = point_quadtree::morton_keys::interleave_coordinates(coordinate(rng), coordinate(rng));
+    }
+    std::sort(keys.begin(), keys.end());
+    std::uniform_int_distribution<size_t> offset(1, 16);
+    std::vector<std::pair<primitives::morton_key_t, primitives::morton_key_t>> segments;
+    for (size_t i {0}; i < point_count; ++i)
+    {
+        segments.push_back({keys[i], keys[(i + offset(rng)) % point_count]});
+    }
+
+    for (const auto& [key1, key2] : segments)
+    {
+        const auto path {point_quadtree::morton_keys::segment_insertion_path(key1, key2)};
+        const auto old_path {vector_insertion_path(key1, key2)};
+        bool same {path.depth == static_cast<primitives::depth_t>(old_path.size())};
+        for (primitives::depth_t depth {0}; same and depth < path.depth; ++depth)
+        {
+            same = path.quadrant(depth) == old_path[depth];
+        }
+        if (not same)
+        {
+            std::cout << __func__ << ": error: paths differ for keys " << key1 << " and " << key2 << std::endl;
+            std::abort();
+        }
+    }
+
+    size_t checksum {0};
+    const auto vector_ns {time_paths(segments, repeats, checksum
+        , [](primitives::morton_key_t key1, primitives::morton_key_t key2)
+        {
+            size_t sum {0};
+            for (auto quadrant : vector_insertion_path(key1, key2))
+            {
+                sum += quadrant;
+            }
+            return sum;
+        })};
+    const auto segment_path_ns {time_paths(segments, repeats, checksum
+        , [](primitives::morton_key_t key1, primitives::morton_key_t key2)
+        {
+            const auto path {point_quadtree::morton_keys::segment_insertion_path(key1, key2)};
+            size_t sum {0};
+            for (primitives::depth_t depth {0}; depth < path.depth; ++depth)
+            {
+                sum += path.quadrant(depth);
+            }
+            return sum;
+        })};
+    std::cout << repeats * segments.size() << " paths built and walked (checksum " << checksum << ")" << std::endl;
+    std::cout << "std::vector path: " << vector_ns << " ns/path" << std::endl;
+    std::cout << "SegmentPath:      " << segment_path_ns << " ns/path" << std::endl;
+    return 0;
+}
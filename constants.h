@@ -13,7 +13,7 @@ constexpr primitives::depth_t max_tree_depth{21}; // maximum quadtree depth / le
 constexpr bool verbose {false};
 constexpr bool write_best {true};
 constexpr bool print_local_optima {true};
-constexpr bool print_iterations {true};
-constexpr bool verify {true};
+constexpr bool print_iterations {false};
+constexpr bool verify {false}; // walks the whole tour after every move; for debugging.
 
 } // namespace constants
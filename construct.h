@@ -0,0 +1,192 @@
+#pragma once
+
+// Construction of initial tours, for when no tour file is given.
+
+#include "DistanceCalculator.h"
+#include "Segment.h"
+#include "ThreadPool.h"
+#include "constants.h"
+#include "point_quadtree/NearestPoints.h"
+#include "point_quadtree/NeighbourLists.h"
+#include "point_quadtree/PointSubset.h"
+#include "point_quadtree/Quadtree.h"
+#include "point_quadtree/radix_sort.h"
+#include "primitives.h"
+
+#include <algorithm> // sort, unique
+#include <array>
+#include <numeric> // iota
+#include <tuple>
+#include <vector>
+
+namespace construct {
+
+// Visits points in order of their space-filling curve keys (Morton or Hilbert).
+inline std::vector<primitives::point_id_t> space_filling_curve(const std::vector<primitives::morton_key_t>& keys
+    , ThreadPool& thread_pool)
+{
+    return point_quadtree::sort_by_morton_key(keys, thread_pool);
+}
+
+// Starting from point 0, repeatedly visits the nearest unvisited point.
+template <typename Metric>
+inline std::vector<primitives::point_id_t> nearest_neighbour(const point_quadtree::Quadtree<Metric>& quadtree
+    , const DistanceCalculator<Metric>& dc, primitives::point_id_t point_count)
+{
+    std::vector<primitives::point_id_t> tour;
+    tour.reserve(point_count);
+    point_quadtree::PointSubset<Metric> unvisited(quadtree, point_count, true);
+    point_quadtree::NearestPoints nearest(1);
+    std::vector<primitives::point_id_t> next;
+    primitives::point_id_t i {0};
+    while (true)
+    {
+        tour.push_back(i);
+        unvisited.erase(i);
+        if (unvisited.size() == 0)
+        {
+            return tour;
+        }
+        quadtree.nearest(i, dc, unvisited, nearest);
+        next.clear();
+        nearest.take(next);
+        i = next.front();
+    }
+}
+
+// Points linked into paths by greedy.
+class Fragments
+{
+public:
+    Fragments(primitives::point_id_t point_count)
+        : m_links(point_count, {constants::invalid_point, constants::invalid_point})
+        , m_parent(point_count)
+    {
+        std::iota(std::begin(m_parent), std::end(m_parent), 0);
+    }
+
+    bool endpoint(primitives::point_id_t i) const { return m_links[i][1] == constants::invalid_point; }
+
+    // Links a and b if both are endpoints of different fragments.
+    bool link(primitives::point_id_t a, primitives::point_id_t b)
+    {
+        if (not endpoint(a) or not endpoint(b) or root(a) == root(b))
+        {
+            return false;
+        }
+        add_link(a, b);
+        add_link(b, a);
+        m_parent[root(a)] = root(b);
+        return true;
+    }
+
+    // Appends the fragment with endpoint i to tour, from i; returns the other endpoint.
+    primitives::point_id_t walk(primitives::point_id_t i, std::vector<primitives::point_id_t>& tour) const
+    {
+        auto previous {constants::invalid_point};
+        while (true)
+        {
+            tour.push_back(i);
+            const auto& links {m_links[i]};
+            const auto next {links[0] != previous ? links[0] : links[1]};
+            if (next == constants::invalid_point)
+            {
+                return i;
+            }
+            previous = i;
+            i = next;
+        }
+    }
+
+private:
+    std::vector<std::array<primitives::point_id_t, 2>> m_links; // index corresponds to point id.
+    mutable std::vector<primitives::point_id_t> m_parent; // union-find forest of fragments.
+
+    primitives::point_id_t root(primitives::point_id_t i) const
+    {
+        while (m_parent[i] != i)
+        {
+            m_parent[i] = m_parent[m_parent[i]]; // path halving.
+            i = m_parent[i];
+        }
+        return i;
+    }
+
+    void add_link(primitives::point_id_t a, primitives::point_id_t b)
+    {
+        m_links[a][m_links[a][0] == constants::invalid_point ? 0 : 1] = b;
+    }
+};
+
+// Greedy edge matching: candidate segments from every point to its nearest points are added shortest first,
+//  unless they would give a point three segments or close a cycle.
+// The resulting paths are then joined into a tour, each to the nearest free endpoint of another path.
+template <typename Metric>
+inline std::vector<primitives::point_id_t> greedy(const point_quadtree::Quadtree<Metric>& quadtree
+    , const DistanceCalculator<Metric>& dc, primitives::point_id_t point_count, ThreadPool& thread_pool)
+{
+    std::vector<primitives::point_id_t> tour;
+    if (point_count < 3)
+    {
+        for (primitives::point_id_t i {0}; i < point_count; ++i)
+        {
+            tour.push_back(i);
+        }
+        return tour;
+    }
+    constexpr size_t candidates_per_point {10};
+    const point_quadtree::NeighbourLists neighbours(quadtree, dc, point_count, candidates_per_point, thread_pool);
+    std::vector<Segment> candidates;
+    for (primitives::point_id_t i {0}; i < point_count; ++i)
+    {
+        for (auto it {neighbours.begin(i)}; it != neighbours.end(i); ++it)
+        {
+            candidates.push_back(Segment(i, *it, dc));
+        }
+    }
+    const auto key = [](const Segment& s) { return std::make_tuple(s.length, s.min, s.max); };
+    std::sort(std::begin(candidates), std::end(candidates)
+        , [&key](const Segment& lhs, const Segment& rhs) { return key(lhs) < key(rhs); });
+    candidates.erase(std::unique(std::begin(candidates), std::end(candidates)
+        , [&key](const Segment& lhs, const Segment& rhs) { return key(lhs) == key(rhs); }), std::end(candidates));
+
+    Fragments fragments(point_count);
+    for (const auto& s : candidates)
+    {
+        fragments.link(s.min, s.max);
+    }
+
+    // join fragments by nearest endpoints.
+    point_quadtree::PointSubset<Metric> endpoints(quadtree, point_count, false);
+    for (primitives::point_id_t i {0}; i < point_count; ++i)
+    {
+        if (fragments.endpoint(i))
+        {
+            endpoints.insert(i);
+        }
+    }
+    tour.reserve(point_count);
+    point_quadtree::NearestPoints nearest(1);
+    std::vector<primitives::point_id_t> next;
+    primitives::point_id_t i {0};
+    while (not endpoints.contains(i))
+    {
+        ++i;
+    }
+    while (true)
+    {
+        endpoints.erase(i);
+        const auto end {fragments.walk(i, tour)};
+        endpoints.erase(end);
+        if (endpoints.size() == 0)
+        {
+            return tour;
+        }
+        quadtree.nearest(end, dc, endpoints, nearest);
+        next.clear();
+        nearest.take(next);
+        i = next.front();
+    }
+}
+
+} // namespace construct
@@ -1,8 +1,10 @@
 #include "PointSet.h"
 
+#include <cstdlib> // abort
+
 namespace fileio {
 
-PointSet::PointSet(const std::string& file_path)
+PointSet::PointSet(const std::string& file_path, bool keep_exact)
 {
     std::cout << "\nReading point set file: " << file_path << std::endl;
     std::ifstream file_stream(file_path);
@@ -27,6 +29,12 @@ PointSet::PointSet(const std::string& file_path)
             point_count = std::stoi(point_count_string);
             std::cout << "Number of points according to header: " << point_count << std::endl;
         }
+        if (line.find("EDGE_WEIGHT_TYPE") != std::string::npos)
+        {
+            std::stringstream value_stream(line.substr(line.find(':') + 1));
+            value_stream >> m_edge_weight_type;
+            std::cout << "Edge weight type according to header: " << m_edge_weight_type << std::endl;
+        }
     }
     if (point_count == 0)
     {
@@ -46,11 +54,16 @@ PointSet::PointSet(const std::string& file_path)
         line_stream >> point_id;
         if (point_id == m_x.size() + 1)
         {
-            primitives::space_t value{0};
-            line_stream >> value;
-            m_x.push_back(value);
-            line_stream >> value;
-            m_y.push_back(value);
+            primitives::space_t x{0};
+            primitives::space_t y{0};
+            line_stream >> x >> y;
+            m_x.push_back(primitives::to_coordinate(x));
+            m_y.push_back(primitives::to_coordinate(y));
+            if (keep_exact)
+            {
+                m_exact_x.push_back(x);
+                m_exact_y.push_back(y);
+            }
         }
         else
         {
@@ -64,5 +77,53 @@ PointSet::PointSet(const std::string& file_path)
     std::cout << "Finished reading point set file.\n" << std::endl;
 }
 
+namespace {
+
+template <typename T>
+std::vector<T> permute(const std::vector<T>& values, const std::vector<primitives::point_id_t>& order)
+{
+    std::vector<T> permuted;
+    permuted.reserve(values.size());
+    for (auto i : order)
+    {
+        permuted.push_back(values[i]);
+    }
+    return permuted;
+}
+
+} // namespace
+
+void PointSet::renumber(const std::vector<primitives::point_id_t>& order)
+{
+    if (order.size() != count())
+    {
+        std::cout << __func__ << ": error: order has " << order.size() << " points instead of " << count() << std::endl;
+        std::abort();
+    }
+    m_x = permute(m_x, order);
+    m_y = permute(m_y, order);
+    if (not m_exact_x.empty())
+    {
+        m_exact_x = permute(m_exact_x, order);
+        m_exact_y = permute(m_exact_y, order);
+    }
+    m_file_ids = m_file_ids.empty() ? order : permute(m_file_ids, order);
+    m_ids.resize(count());
+    for (primitives::point_id_t i {0}; i < count(); ++i)
+    {
+        m_ids[m_file_ids[i]] = i;
+    }
+}
+
+std::vector<primitives::point_id_t> PointSet::to_file_ids(const std::vector<primitives::point_id_t>& points) const
+{
+    return m_file_ids.empty() ? points : permute(m_file_ids, points);
+}
+
+std::vector<primitives::point_id_t> PointSet::from_file_ids(const std::vector<primitives::point_id_t>& points) const
+{
+    return m_ids.empty() ? points : permute(m_ids, points);
+}
+
 } // namespace fileio
 
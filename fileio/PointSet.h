@@ -1,6 +1,6 @@
 #pragma once
 
-// This represents a TSPLIB-formatted Euclidean TSP instance.
+// This represents a TSPLIB-formatted TSP instance with node coordinates.
 
 #include <primitives.h>
 
@@ -15,14 +15,33 @@ namespace fileio {
 class PointSet
 {
 public:
-    PointSet(const std::string& file_path);
+    // keep_exact: also keep the coordinates as read, for comparison with reduced-precision coordinates.
+    PointSet(const std::string& file_path, bool keep_exact = false);
     size_t count() const { return m_x.size(); }
-    const std::vector<primitives::space_t>& x() const { return m_x; }
-    const std::vector<primitives::space_t>& y() const { return m_y; }
+    const std::vector<primitives::coordinate_t>& x() const { return m_x; }
+    const std::vector<primitives::coordinate_t>& y() const { return m_y; }
+    // empty unless keep_exact.
+    const std::vector<primitives::space_t>& exact_x() const { return m_exact_x; }
+    const std::vector<primitives::space_t>& exact_y() const { return m_exact_y; }
+    // as in the EDGE_WEIGHT_TYPE header; EUC_2D if absent.
+    const std::string& edge_weight_type() const { return m_edge_weight_type; }
+
+    // Renumbers points so that point i becomes the point that was order[i],
+    //  e.g. in space-filling curve order, so that points near in space are near in memory.
+    void renumber(const std::vector<primitives::point_id_t>& order);
+    // Point ids as in the file, for ids of the current numbering.
+    std::vector<primitives::point_id_t> to_file_ids(const std::vector<primitives::point_id_t>& points) const;
+    // Point ids of the current numbering, for ids as in the file.
+    std::vector<primitives::point_id_t> from_file_ids(const std::vector<primitives::point_id_t>& points) const;
 
 private:
-    std::vector<primitives::space_t> m_x;
-    std::vector<primitives::space_t> m_y;
+    std::vector<primitives::coordinate_t> m_x;
+    std::vector<primitives::coordinate_t> m_y;
+    std::vector<primitives::space_t> m_exact_x;
+    std::vector<primitives::space_t> m_exact_y;
+    std::string m_edge_weight_type {"EUC_2D"};
+    std::vector<primitives::point_id_t> m_file_ids; // index corresponds to point id; empty if not renumbered.
+    std::vector<primitives::point_id_t> m_ids; // index corresponds to file id; empty if not renumbered.
 };
 
 } // namespace fileio
@@ -96,12 +96,12 @@ inline std::vector<primitives::point_id_t> default_tour(primitives::point_id_t p
     return tour;
 }
 
-inline std::vector<primitives::point_id_t> initial_tour(int argc, const char** argv, primitives::point_id_t point_count)
+inline std::vector<primitives::point_id_t> initial_tour(const std::string& tour_file_path, primitives::point_id_t point_count)
 {
     std::vector<primitives::point_id_t> tour;
-    if (argc > 2)
+    if (not tour_file_path.empty())
     {
-        tour = read_initial_tour(argv[2]);
+        tour = read_initial_tour(tour_file_path);
     }
     else
     {
@@ -0,0 +1,156 @@
+#pragma once
+
+// TSPLIB edge weight types, as compile-time policies of DistanceCalculator.
+// Each policy defines:
+//  length: the TSPLIB length between two points.
+//  planar: whether lengths grow with coordinate distance, so that quadtree searches can be pruned.
+// Planar policies also define:
+//  radius: coordinate distance beyond which no point is within length.
+//  squared_bound: squared coordinate distance beyond which lengths exceed length (see DistanceCalculator).
+// Cached<Base, Cache> is Base with lengths cached by DistanceCalculator, so that the cache is chosen at
+//  compile time like the edge weight type, and uncached lengths have no cache checks.
+
+#include "primitives.h"
+
+#include <cmath> // sqrt, ceil, cos, acos
+#include <cstdint> // int64_t
+
+namespace metric {
+
+// relative slack of squared bounds, to cover floating-point error.
+constexpr double squared_slack {1 + 1e-9};
+
+// lengths fit in a signed integer, which converts to double in one instruction.
+inline double to_double(primitives::length_t length)
+{
+    return static_cast<double>(static_cast<std::int64_t>(length));
+}
+
+// EUC_2D: Euclidean distance rounded to the nearest integer.
+struct Euc2d
+{
+    static constexpr bool planar {true};
+    static primitives::length_t length(primitives::space_t xa, primitives::space_t ya
+        , primitives::space_t xb, primitives::space_t yb)
+    {
+        const auto dx {xa - xb};
+        const auto dy {ya - yb};
+        return std::sqrt(dx * dx + dy * dy) + 0.5; // return type cast.
+    }
+    static primitives::space_t radius(primitives::space_t length) { return length + 0.5; }
+    // a rounded length exceeds length exactly when the distance reaches length + 0.5.
+    static double squared_bound(primitives::length_t length)
+    {
+        const auto bound {to_double(length) + 0.5};
+        return bound * bound * squared_slack;
+    }
+};
+
+// CEIL_2D: Euclidean distance rounded up.
+struct Ceil2d
+{
+    static constexpr bool planar {true};
+    static primitives::length_t length(primitives::space_t xa, primitives::space_t ya
+        , primitives::space_t xb, primitives::space_t yb)
+    {
+        const auto dx {xa - xb};
+        const auto dy {ya - yb};
+        return std::ceil(std::sqrt(dx * dx + dy * dy)); // return type cast.
+    }
+    static primitives::space_t radius(primitives::space_t length) { return length; }
+    static double squared_bound(primitives::length_t length)
+    {
+        const auto bound {to_double(length)};
+        return bound * bound * squared_slack;
+    }
+};
+
+// ATT: pseudo-Euclidean distance of the att48 and att532 instances, sqrt((dx^2 + dy^2) / 10) rounded up.
+struct Att
+{
+    static constexpr bool planar {true};
+    static primitives::length_t length(primitives::space_t xa, primitives::space_t ya
+        , primitives::space_t xb, primitives::space_t yb)
+    {
+        const auto dx {xa - xb};
+        const auto dy {ya - yb};
+        const auto exact {std::sqrt((dx * dx + dy * dy) / 10.0)};
+        const primitives::length_t rounded = exact + 0.5; // as TSPLIB nint.
+        return rounded < exact ? rounded + 1 : rounded;
+    }
+    // sqrt(10), rounded up.
+    static primitives::space_t radius(primitives::space_t length) { return length * 3.1622777; }
+    // lengths exceed length exactly when (dx^2 + dy^2) / 10 exceeds length^2.
+    static double squared_bound(primitives::length_t length)
+    {
+        const auto bound {to_double(length)};
+        return 10 * bound * bound * squared_slack;
+    }
+};
+
+// GEO: great circle distance in kilometers, with coordinates as latitude and longitude in DDD.MM form.
+// Lengths do not grow with coordinate distance, so quadtree searches are not pruned.
+struct Geo
+{
+    static constexpr bool planar {false};
+    static primitives::length_t length(primitives::space_t xa, primitives::space_t ya
+        , primitives::space_t xb, primitives::space_t yb)
+    {
+        const auto latitude_a {radians(xa)};
+        const auto latitude_b {radians(xb)};
+        const auto q1 {std::cos(radians(ya) - radians(yb))};
+        const auto q2 {std::cos(latitude_a - latitude_b)};
+        const auto q3 {std::cos(latitude_a + latitude_b)};
+        constexpr double earth_radius {6378.388};
+        return earth_radius * std::acos(0.5 * ((1 + q1) * q2 - (1 - q1) * q3)) + 1; // return type cast.
+    }
+
+private:
+    // TSPLIB truncates degrees, and uses its own value of pi.
+    static double radians(primitives::space_t coordinate)
+    {
+        constexpr double pi {3.141592};
+        const auto degrees {static_cast<double>(static_cast<std::int64_t>(coordinate))};
+        const auto minutes {coordinate - degrees};
+        return pi * (degrees + 5 * minutes / 3) / 180;
+    }
+};
+
+// How DistanceCalculator caches lengths.
+enum class DistanceCache
+{
+    none
+    , table // all point pairs, filled on first use; n * (n - 1) / 2 entries.
+    , hashed // fixed number of entries, each holding the last pair hashed to it.
+};
+
+template <typename Base, DistanceCache Cache>
+struct Cached : Base {};
+
+template <typename Base>
+using Table = Cached<Base, DistanceCache::table>;
+template <typename Base>
+using Hashed = Cached<Base, DistanceCache::hashed>;
+
+template <typename Metric>
+constexpr DistanceCache cache {DistanceCache::none};
+template <typename Base, DistanceCache Cache>
+constexpr DistanceCache cache<Cached<Base, Cache>> {Cache};
+
+} // namespace metric
+
+// Calls INSTANTIATE(Metric) for every policy that v-opt runs with (see run and run_cached in v-opt.cpp):
+//  each edge weight type, uncached and with each cache. Explicit instantiations in .cpp files use this list.
+#define METRIC_FOR_EACH_POLICY(INSTANTIATE) \
+    INSTANTIATE(metric::Euc2d) \
+    INSTANTIATE(metric::Ceil2d) \
+    INSTANTIATE(metric::Att) \
+    INSTANTIATE(metric::Geo) \
+    INSTANTIATE(metric::Table<metric::Euc2d>) \
+    INSTANTIATE(metric::Table<metric::Ceil2d>) \
+    INSTANTIATE(metric::Table<metric::Att>) \
+    INSTANTIATE(metric::Table<metric::Geo>) \
+    INSTANTIATE(metric::Hashed<metric::Euc2d>) \
+    INSTANTIATE(metric::Hashed<metric::Ceil2d>) \
+    INSTANTIATE(metric::Hashed<metric::Att>) \
+    INSTANTIATE(metric::Hashed<metric::Geo>)
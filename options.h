@@ -0,0 +1,301 @@
+#pragma once
+
+// Command line arguments: positional file paths followed by optional "--name=value" settings.
+
+#include <cstdlib> // exit, EXIT_FAILURE
+#include <iostream>
+#include <limits> // numeric_limits
+#include <string>
+
+namespace options {
+
+// more threads than this would only add scheduling overhead, on any machine we run on.
+constexpr size_t max_threads {1024};
+
+enum class Perturbation
+{
+    none
+    , first_improvement
+    , best_improvement
+};
+
+enum class Tree
+{
+    pointer
+    , linear
+};
+
+enum class Search
+{
+    quadtree // all points near enough to improve on the best move found so far.
+    , candidates // nearest neighbours only.
+};
+
+enum class Init
+{
+    identity // points in input order.
+    , space_filling_curve // points sorted by curve key.
+    , nearest_neighbour
+    , greedy // greedy edge matching.
+};
+
+enum class Curve
+{
+    hilbert
+    , morton
+};
+
+enum class Renumber
+{
+    none // point ids as in the point set file.
+    , hilbert // point ids in curve order.
+    , morton
+};
+
+enum class DistanceCache
+{
+    none
+    , table // all point pairs.
+    , hashed // recently used pairs.
+    , automatic // table for point sets with up to 4096 points, otherwise hashed.
+};
+
+struct Options
+{
+    std::string point_set_file_path;
+    std::string tour_file_path; // optional; empty if not provided.
+    std::string output_file_path; // final tour, with point ids as in the point set file; empty for none.
+    size_t threads {1};
+    bool batch {false}; // apply all compatible improving moves found by each search pass.
+    Perturbation perturbation {Perturbation::none};
+    size_t max_perturbations {1 << 16}; // best perturbation candidates kept per perturbation round.
+    size_t time_limit {0}; // seconds spent on perturbations; 0 for no limit.
+    size_t max_evaluations {0}; // perturbations evaluated in total; 0 for no limit.
+    Tree tree {Tree::pointer}; // quadtree engine.
+    Search search {Search::quadtree};
+    size_t candidates {8}; // nearest neighbours per point searched by Search::candidates.
+    Init init {Init::space_filling_curve}; // initial tour, if no tour file is given.
+    Curve curve {Curve::hilbert}; // space-filling curve used to order points.
+    size_t leaf_capacity {8}; // most points in a leaf above the deepest level; 0 for fixed-depth leaves.
+    Renumber renumber {Renumber::none}; // point ids used internally.
+    DistanceCache distance_cache {DistanceCache::none};
+    size_t cache_entries {1 << 20}; // entries of the hashed distance cache.
+    bool validate {false}; // also report tour lengths under the coordinates as read, in reduced-precision builds.
+};
+
+inline void print_usage()
+{
+    std::cout << "Arguments: point_set_file_path optional_tour_file_path [options]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "    --threads=N    number of threads used to search for improvements (default: 1, at most 1024)." << std::endl;
+    std::cout << "    --batch        apply all compatible improving moves found by each search pass." << std::endl;
+    std::cout << "    --perturb=M    after hill climbing, repeatedly escape local optima with perturbations;" << std::endl;
+    std::cout << "                   M is \"first\" or \"best\" (improvement)." << std::endl;
+    std::cout << "    --max-perturbations=K    perturbation candidates kept per round, best first (default: 65536)." << std::endl;
+    std::cout << "    --time-limit=S           stop perturbing after S seconds (default and 0: no limit)." << std::endl;
+    std::cout << "    --max-evaluations=N      stop perturbing after evaluating N perturbations (default and 0: no limit)." << std::endl;
+    std::cout << "    --tree=T       quadtree engine: \"pointer\" (linked nodes, default) or \"linear\" (node arrays)." << std::endl;
+    std::cout << "    --search=S     V-move search: \"quadtree\" (default) or \"candidates\" (nearest neighbours only)." << std::endl;
+    std::cout << "    --candidates=K           nearest neighbours per point for --search=candidates (default: 8)." << std::endl;
+    std::cout << "    --init=I       initial tour if no tour file is given: \"sfc\" (points in curve order, default)," << std::endl;
+    std::cout << "                   \"nn\" (nearest neighbour), \"greedy\" (greedy edge matching)" << std::endl;
+    std::cout << "                   or \"identity\" (points in input order)." << std::endl;
+    std::cout << "    --curve=C      space-filling curve: \"hilbert\" (default) or \"morton\"." << std::endl;
+    std::cout << "    --leaf-capacity=B        nodes with up to B points are leaves (default: 8; 0 for leaves at the deepest level)." << std::endl;
+    std::cout << "    --renumber=C   renumber points internally in curve order, for memory locality: \"none\" (default)," << std::endl;
+    std::cout << "                   \"hilbert\" or \"morton\"; tour files are read and written with ids as in the point set file." << std::endl;
+    std::cout << "    --output=FILE  write the final tour to FILE." << std::endl;
+    std::cout << "    --distance-cache=C       cache lengths of point pairs: \"none\" (default), \"table\" (all pairs)," << std::endl;
+    std::cout << "                   \"hashed\" (recently used pairs) or \"auto\" (table for small point sets); prints hit rates." << std::endl;
+    std::cout << "    --cache-entries=N        entries of the hashed distance cache (default: 1048576)." << std::endl;
+    std::cout << "    --validate     also report tour lengths with double coordinates, as a double build would," << std::endl;
+    std::cout << "                   in builds with float or fixed-point coordinates (see makefile)." << std::endl;
+}
+
+inline void bad_option(const std::string& argument)
+{
+    std::cout << __func__ << ": bad input: unrecognized or malformed argument: " << argument << std::endl;
+    print_usage();
+    std::exit(EXIT_FAILURE);
+}
+
+inline size_t parse_number(const std::string& argument, const std::string& value)
+{
+    if (value.empty() or value.find_first_not_of("0123456789") != std::string::npos)
+    {
+        bad_option(argument);
+    }
+    size_t number {0};
+    for (auto c : value)
+    {
+        const size_t digit = c - '0';
+        if (number > (std::numeric_limits<size_t>::max() - digit) / 10)
+        {
+            bad_option(argument);
+        }
+        number = number * 10 + digit;
+    }
+    return number;
+}
+
+inline size_t parse_count(const std::string& argument, const std::string& value
+    , size_t max_count = std::numeric_limits<size_t>::max())
+{
+    const auto count {parse_number(argument, value)};
+    if (count == 0 or count > max_count)
+    {
+        bad_option(argument);
+    }
+    return count;
+}
+
+inline Options parse(int argc, const char** argv)
+{
+    Options options;
+    int positional {0};
+    for (int i {1}; i < argc; ++i)
+    {
+        const std::string argument(argv[i]);
+        if (argument.compare(0, 2, "--") != 0)
+        {
+            switch (positional++)
+            {
+                case 0: options.point_set_file_path = argument; break;
+                case 1: options.tour_file_path = argument; break;
+                default: bad_option(argument);
+            }
+            continue;
+        }
+        const auto equals {argument.find('=')};
+        const auto name {argument.substr(0, equals)};
+        const auto value {equals == std::string::npos ? std::string() : argument.substr(equals + 1)};
+        if (name == "--threads")
+        {
+            options.threads = parse_count(argument, value, max_threads);
+        }
+        else if (argument == "--batch")
+        {
+            options.batch = true;
+        }
+        else if (argument == "--validate")
+        {
+            options.validate = true;
+        }
+        else if (name == "--perturb" and value == "first")
+        {
+            options.perturbation = Perturbation::first_improvement;
+        }
+        else if (name == "--perturb" and value == "best")
+        {
+            options.perturbation = Perturbation::best_improvement;
+        }
+        else if (name == "--tree" and value == "pointer")
+        {
+            options.tree = Tree::pointer;
+        }
+        else if (name == "--tree" and value == "linear")
+        {
+            options.tree = Tree::linear;
+        }
+        else if (name == "--search" and value == "quadtree")
+        {
+            options.search = Search::quadtree;
+        }
+        else if (name == "--search" and value == "candidates")
+        {
+            options.search = Search::candidates;
+        }
+        else if (name == "--candidates")
+        {
+            options.candidates = parse_count(argument, value);
+        }
+        else if (name == "--renumber" and value == "none")
+        {
+            options.renumber = Renumber::none;
+        }
+        else if (name == "--renumber" and value == "hilbert")
+        {
+            options.renumber = Renumber::hilbert;
+        }
+        else if (name == "--renumber" and value == "morton")
+        {
+            options.renumber = Renumber::morton;
+        }
+        else if (name == "--output" and not value.empty())
+        {
+            options.output_file_path = value;
+        }
+        else if (name == "--distance-cache" and value == "none")
+        {
+            options.distance_cache = DistanceCache::none;
+        }
+        else if (name == "--distance-cache" and value == "table")
+        {
+            options.distance_cache = DistanceCache::table;
+        }
+        else if (name == "--distance-cache" and value == "hashed")
+        {
+            options.distance_cache = DistanceCache::hashed;
+        }
+        else if (name == "--distance-cache" and value == "auto")
+        {
+            options.distance_cache = DistanceCache::automatic;
+        }
+        else if (name == "--cache-entries")
+        {
+            options.cache_entries = parse_count(argument, value);
+        }
+        else if (name == "--init" and value == "sfc")
+        {
+            options.init = Init::space_filling_curve;
+        }
+        else if (name == "--init" and value == "nn")
+        {
+            options.init = Init::nearest_neighbour;
+        }
+        else if (name == "--init" and value == "greedy")
+        {
+            options.init = Init::greedy;
+        }
+        else if (name == "--init" and value == "identity")
+        {
+            options.init = Init::identity;
+        }
+        else if (name == "--curve" and value == "hilbert")
+        {
+            options.curve = Curve::hilbert;
+        }
+        else if (name == "--curve" and value == "morton")
+        {
+            options.curve = Curve::morton;
+        }
+        else if (name == "--leaf-capacity")
+        {
+            options.leaf_capacity = parse_number(argument, value);
+        }
+        else if (name == "--max-perturbations")
+        {
+            options.max_perturbations = parse_count(argument, value);
+        }
+        else if (name == "--time-limit")
+        {
+            options.time_limit = parse_number(argument, value);
+        }
+        else if (name == "--max-evaluations")
+        {
+            options.max_evaluations = parse_number(argument, value);
+        }
+        else
+        {
+            bad_option(argument);
+        }
+    }
+    if (options.point_set_file_path.empty())
+    {
+        print_usage();
+        std::exit(EXIT_FAILURE);
+    }
+    return options;
+}
+
+} // namespace options
@@ -0,0 +1,108 @@
+#pragma once
+
+// Quadtree engine that searches V-moves of point i only to the nearest neighbours of i,
+//  like the candidate lists of Lin-Kernighan implementations, so every search costs the same.
+// Moves to points outside of the lists are missed, so local optima are not those of a full search.
+// Everything but search is delegated to the underlying engine, which keeps the segment state
+//  used by perturbation searches.
+
+#include "NeighbourLists.h"
+#include "Quadtree.h"
+#include "search_points.h"
+#include <DistanceCalculator.h>
+#include <ThreadPool.h>
+
+#include <memory>
+#include <utility> // move
+#include <vector>
+
+namespace point_quadtree {
+
+template <typename Metric>
+class CandidateQuadtree : public Quadtree<Metric>
+{
+public:
+    CandidateQuadtree(std::unique_ptr<Quadtree<Metric>> quadtree, const DistanceCalculator<Metric>& dc
+        , primitives::point_id_t point_count, size_t k, ThreadPool& thread_pool)
+        : m_quadtree(std::move(quadtree))
+        , m_neighbours(*m_quadtree, dc, point_count, k, thread_pool) {}
+
+    size_t size() const override { return m_quadtree->size(); }
+    primitives::node_id_t leaf(primitives::point_id_t i) const override { return m_quadtree->leaf(i); }
+    primitives::node_id_t parent(primitives::node_id_t node) const override { return m_quadtree->parent(node); }
+
+    void nearest(primitives::point_id_t i, const DistanceCalculator<Metric>& dc
+        , const PointSubset<Metric>& subset, NearestPoints& nearest_points) const override
+    {
+        m_quadtree->nearest(i, dc, subset, nearest_points);
+    }
+
+    // search does not need the node, but perturbation searches do.
+    primitives::node_id_t expand(primitives::node_id_t node
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t old_segments_length, const SegmentState& state) const override
+    {
+        return m_quadtree->expand(node, x, y, old_segments_length, state);
+    }
+    primitives::node_id_t expand_simple(primitives::node_id_t node
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t min_radius, const SegmentState& state) const override
+    {
+        return m_quadtree->expand_simple(node, x, y, min_radius, state);
+    }
+
+    VMove search(primitives::node_id_t
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+        , const DistanceCalculator<Metric>& dc
+        , const std::vector<primitives::length_t>& next_lengths
+        , primitives::length_t old_segments_length
+        , const SegmentState&
+        , const Segment& permanent_segment) const override
+    {
+        VMove move;
+        const bool has_permanent {permanent_segment.length > 0};
+        if (has_permanent
+            and (permanent_segment.same(i, adjacents[i][0]) or permanent_segment.same(i, adjacents[i][1])))
+        {
+            return move;
+        }
+        const auto new_adjacent_length {dc.compute_length(adjacents[i][0], adjacents[i][1])};
+        search_points(m_neighbours.begin(i), m_neighbours.end(i), i
+            , next, dc, next_lengths, old_segments_length, new_adjacent_length, permanent_segment, move);
+        return move;
+    }
+
+    void search_perturbation(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<primitives::length_t>& next_lengths
+        , const DistanceCalculator<Metric>& dc
+        , primitives::length_t min_adjacent_length
+        , primitives::length_t new_adjacent_length
+        , TopMoves& perturbations) const override
+    {
+        m_quadtree->search_perturbation(node, i, next, next_lengths, dc, min_adjacent_length, new_adjacent_length, perturbations);
+    }
+    void search_perturbation_lax(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<primitives::length_t>& next_lengths
+        , const DistanceCalculator<Metric>& dc
+        , primitives::length_t max_adjacent_length
+        , primitives::length_t new_adjacent_length
+        , TopMoves& perturbations) const override
+    {
+        m_quadtree->search_perturbation_lax(node, i, next, next_lengths, dc, max_adjacent_length, new_adjacent_length, perturbations);
+    }
+
+    void add_segment(const Segment& s, SegmentState& state) const override { m_quadtree->add_segment(s, state); }
+    void remove_segment(const Segment& s, SegmentState& state) const override { m_quadtree->remove_segment(s, state); }
+
+private:
+    const std::unique_ptr<Quadtree<Metric>> m_quadtree;
+    const NeighbourLists m_neighbours;
+};
+
+} // namespace point_quadtree
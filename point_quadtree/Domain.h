@@ -13,13 +13,13 @@ namespace point_quadtree {
 class Domain
 {
 public:
-    Domain(const std::vector<primitives::space_t>& x, const std::vector<primitives::space_t>& y)
+    Domain(const std::vector<primitives::coordinate_t>& x, const std::vector<primitives::coordinate_t>& y)
     {
         // Get domain bounds
-        m_xmin = *std::min_element(x.begin(), x.end());
-        primitives::space_t xmax = *std::max_element(x.begin(), x.end());
-        m_ymin = *std::min_element(y.begin(), y.end());
-        primitives::space_t ymax = *std::max_element(y.begin(), y.end());
+        m_xmin = primitives::to_space(*std::min_element(x.begin(), x.end()));
+        primitives::space_t xmax = primitives::to_space(*std::max_element(x.begin(), x.end()));
+        m_ymin = primitives::to_space(*std::min_element(y.begin(), y.end()));
+        primitives::space_t ymax = primitives::to_space(*std::max_element(y.begin(), y.end()));
         primitives::space_t xrange = xmax - m_xmin;
         primitives::space_t yrange = ymax - m_ymin;
         // Points within each node have the same Morton Key prefix.
@@ -0,0 +1,592 @@
+#include "LinearQuadtree.h"
+
+#include "PointSubset.h"
+#include "point_quadtree.h" // quadrant_x, quadrant_y
+#include "radix_sort.h"
+#include "search_points.h"
+
+#include <algorithm> // max, min
+#include <iostream>
+
+namespace point_quadtree {
+
+template <typename Metric>
+LinearQuadtree<Metric>::LinearQuadtree(const std::vector<primitives::morton_key_t>& morton_keys, const Domain& domain
+    , size_t leaf_capacity, ThreadPool& thread_pool)
+    : m_morton_keys(morton_keys)
+    , m_domain(domain)
+    , m_leaf_capacity(leaf_capacity)
+    , m_points(sort_by_morton_key(morton_keys, thread_pool))
+    , m_leaf(morton_keys.size(), no_node)
+{
+    build(thread_pool);
+}
+
+// The top levels are laid out serially, with the node ranges of the subtrees below them reserved
+//  from their node counts; the subtrees are then built in parallel into their ranges.
+template <typename Metric>
+void LinearQuadtree<Metric>::build(ThreadPool& thread_pool)
+{
+    const auto point_count {static_cast<primitives::point_id_t>(m_points.size())};
+    std::vector<BuildTask> tasks;
+    auto node_count {collect_tasks(0, 0, 0, 0, point_count, tasks)};
+    thread_pool.for_each_chunk(tasks.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (auto t {begin}; t < end; ++t)
+        {
+            tasks[t].node_count = count_nodes(tasks[t].depth, tasks[t].point_begin, tasks[t].point_end);
+        }
+    });
+    for (const auto& task : tasks)
+    {
+        node_count += task.node_count;
+    }
+    m_parent.resize(node_count);
+    m_subtree_end.resize(node_count);
+    m_point_begin.resize(node_count);
+    m_point_end.resize(node_count);
+    m_x.resize(node_count);
+    m_y.resize(node_count);
+    m_depth.resize(node_count);
+    m_top_depth.resize(node_count);
+
+    auto* next_task {tasks.data()};
+    build(0, no_node, 0, 0, 0, 0, point_count, &next_task);
+    thread_pool.for_each_chunk(tasks.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (auto t {begin}; t < end; ++t)
+        {
+            const auto& task {tasks[t]};
+            build(task.node, task.parent, task.depth, task.x, task.y, task.point_begin, task.point_end);
+        }
+    });
+}
+
+template <typename Metric>
+void LinearQuadtree<Metric>::collapse(primitives::depth_t& depth, primitives::grid_t& x, primitives::grid_t& y
+    , primitives::point_id_t point_begin, primitives::point_id_t point_end) const
+{
+    while (depth < constants::max_tree_depth - 1 and point_begin < point_end
+        and morton_keys::quadrant(m_morton_keys[m_points[point_begin]], depth)
+            == morton_keys::quadrant(m_morton_keys[m_points[point_end - 1]], depth))
+    {
+        const auto quadrant {morton_keys::quadrant(m_morton_keys[m_points[point_begin]], depth)};
+        x = (x << 1) + quadrant_x(quadrant);
+        y = (y << 1) + quadrant_y(quadrant);
+        ++depth;
+    }
+}
+
+template <typename Metric>
+primitives::node_id_t LinearQuadtree<Metric>::collect_tasks(primitives::depth_t depth
+    , primitives::grid_t x, primitives::grid_t y
+    , primitives::point_id_t point_begin, primitives::point_id_t point_end
+    , std::vector<BuildTask>& tasks) const
+{
+    if (depth >= task_depth)
+    {
+        BuildTask task;
+        task.depth = depth;
+        task.x = x;
+        task.y = y;
+        task.point_begin = point_begin;
+        task.point_end = point_end;
+        tasks.push_back(task);
+        return 0;
+    }
+    if (point_quadtree::is_leaf(depth, point_end - point_begin, m_leaf_capacity))
+    {
+        return 1;
+    }
+    collapse(depth, x, y, point_begin, point_end);
+    if (depth == constants::max_tree_depth - 1)
+    {
+        return 1;
+    }
+    primitives::node_id_t node_count {1};
+    for (auto child_begin {point_begin}; child_begin < point_end; )
+    {
+        const auto child_end {static_cast<primitives::point_id_t>(
+            quadrant_end(m_points, m_morton_keys, depth, child_begin, point_end))};
+        const auto quadrant {morton_keys::quadrant(m_morton_keys[m_points[child_begin]], depth)};
+        node_count += collect_tasks(depth + 1
+            , (x << 1) + quadrant_x(quadrant)
+            , (y << 1) + quadrant_y(quadrant)
+            , child_begin, child_end, tasks);
+        child_begin = child_end;
+    }
+    return node_count;
+}
+
+template <typename Metric>
+primitives::node_id_t LinearQuadtree<Metric>::count_nodes(primitives::depth_t depth
+    , primitives::point_id_t point_begin, primitives::point_id_t point_end) const
+{
+    if (point_quadtree::is_leaf(depth, point_end - point_begin, m_leaf_capacity))
+    {
+        return 1;
+    }
+    primitives::grid_t x {0};
+    primitives::grid_t y {0};
+    collapse(depth, x, y, point_begin, point_end);
+    if (depth == constants::max_tree_depth - 1)
+    {
+        return 1;
+    }
+    primitives::node_id_t node_count {1};
+    for (auto child_begin {point_begin}; child_begin < point_end; )
+    {
+        const auto child_end {static_cast<primitives::point_id_t>(
+            quadrant_end(m_points, m_morton_keys, depth, child_begin, point_end))};
+        node_count += count_nodes(depth + 1, child_begin, child_end);
+        child_begin = child_end;
+    }
+    return node_count;
+}
+
+template <typename Metric>
+primitives::node_id_t LinearQuadtree<Metric>::build(primitives::node_id_t node, primitives::node_id_t parent
+    , primitives::depth_t depth
+    , primitives::grid_t x, primitives::grid_t y
+    , primitives::point_id_t point_begin, primitives::point_id_t point_end
+    , BuildTask** task)
+{
+    if (task and depth >= task_depth)
+    {
+        auto& reserved {**task};
+        ++*task;
+        reserved.node = node;
+        reserved.parent = parent;
+        return node + reserved.node_count;
+    }
+    const bool leaf {point_quadtree::is_leaf(depth, point_end - point_begin, m_leaf_capacity)};
+    const auto top_depth {depth};
+    if (not leaf)
+    {
+        // collapse the chain of single children.
+        collapse(depth, x, y, point_begin, point_end);
+    }
+    m_parent[node] = parent;
+    m_point_begin[node] = point_begin;
+    m_point_end[node] = point_end;
+    m_x[node] = x;
+    m_y[node] = y;
+    m_depth[node] = static_cast<uint8_t>(depth);
+    m_top_depth[node] = static_cast<uint8_t>(top_depth);
+    if (leaf or depth == constants::max_tree_depth - 1)
+    {
+        for (auto p {point_begin}; p < point_end; ++p)
+        {
+            m_leaf[m_points[p]] = node;
+        }
+        m_subtree_end[node] = node + 1;
+        return node + 1;
+    }
+    // points of each child are contiguous, in quadrant order.
+    auto child {node + 1};
+    for (auto child_begin {point_begin}; child_begin < point_end; )
+    {
+        const auto child_end {static_cast<primitives::point_id_t>(
+            quadrant_end(m_points, m_morton_keys, depth, child_begin, point_end))};
+        const auto quadrant {morton_keys::quadrant(m_morton_keys[m_points[child_begin]], depth)};
+        child = build(child, node, depth + 1
+            , (x << 1) + quadrant_x(quadrant)
+            , (y << 1) + quadrant_y(quadrant)
+            , child_begin, child_end, task);
+        child_begin = child_end;
+    }
+    m_subtree_end[node] = child;
+    return child;
+}
+
+template <typename Metric>
+primitives::space_t LinearQuadtree<Metric>::distance_squared(primitives::node_id_t node
+    , primitives::space_t x, primitives::space_t y) const
+{
+    const auto xdim {m_domain.xdim(m_depth[node])};
+    const auto ydim {m_domain.ydim(m_depth[node])};
+    const auto xmin {m_domain.xmin() + m_x[node] * xdim};
+    const auto ymin {m_domain.ymin() + m_y[node] * ydim};
+    const auto dx {std::max({xmin - x, primitives::space_t{0}, x - (xmin + xdim)})};
+    const auto dy {std::max({ymin - y, primitives::space_t{0}, y - (ymin + ydim)})};
+    return dx * dx + dy * dy;
+}
+
+template <typename Metric>
+primitives::space_t LinearQuadtree<Metric>::margin_squared(primitives::node_id_t node, primitives::depth_t depth
+    , primitives::space_t x, primitives::space_t y) const
+{
+    const auto xdim {m_domain.xdim(depth)};
+    const auto ydim {m_domain.ydim(depth)};
+    const auto xmin {m_domain.xmin() + (m_x[node] >> (m_depth[node] - depth)) * xdim};
+    const auto ymin {m_domain.ymin() + (m_y[node] >> (m_depth[node] - depth)) * ydim};
+    const auto margin_dx {std::min(x - xmin, xmin + xdim - x)};
+    const auto margin_dy {std::min(y - ymin, ymin + ydim - y)};
+    return margin_dx * margin_dx + margin_dy * margin_dy;
+}
+
+template <typename Metric>
+bool LinearQuadtree<Metric>::encloses(primitives::node_id_t node, primitives::depth_t depth
+    , primitives::space_t x, primitives::space_t y, primitives::space_t length) const
+{
+    if constexpr (Metric::planar)
+    {
+        const auto radius {Metric::radius(length)};
+        return margin_squared(node, depth, x, y) >= radius * radius;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+template <typename Metric>
+primitives::node_id_t LinearQuadtree<Metric>::expand(primitives::node_id_t node
+    , primitives::space_t x, primitives::space_t y
+    , primitives::space_t old_segments_length, const SegmentState& state) const
+{
+    return expand(node, m_depth[node], x, y, old_segments_length, state);
+}
+
+template <typename Metric>
+primitives::node_id_t LinearQuadtree<Metric>::expand(primitives::node_id_t node, primitives::depth_t depth
+    , primitives::space_t x, primitives::space_t y
+    , primitives::space_t radius, const SegmentState& state) const
+{
+    // as Node::expand, one level at a time.
+    while (depth > 0)
+    {
+        radius += state.max_segment_length(node);
+        if (encloses(node, depth, x, y, radius))
+        {
+            return node;
+        }
+        if (--depth < m_top_depth[node])
+        {
+            node = m_parent[node];
+        }
+    }
+    return node;
+}
+
+template <typename Metric>
+primitives::node_id_t LinearQuadtree<Metric>::expand_simple(primitives::node_id_t node
+    , primitives::space_t x, primitives::space_t y
+    , primitives::space_t min_radius, const SegmentState& state) const
+{
+    const auto depth {m_depth[node]};
+    if (depth == 0)
+    {
+        return node;
+    }
+    if (encloses(node, depth, x, y, min_radius))
+    {
+        return node;
+    }
+    const auto parent {depth - 1 < m_top_depth[node] ? m_parent[node] : node};
+    return expand(parent, depth - 1, x, y, min_radius, state);
+}
+
+template <typename Metric>
+VMove LinearQuadtree<Metric>::search(primitives::node_id_t node
+    , primitives::point_id_t i
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+    , const DistanceCalculator<Metric>& dc
+    , const std::vector<primitives::length_t>& next_lengths
+    , primitives::length_t old_segments_length
+    , const SegmentState& state
+    , const Segment& permanent_segment) const
+{
+    // segments from points under node to points outside of it are held by ancestors.
+    primitives::length_t outside_length {0};
+    for (auto ancestor {m_parent[node]}; ancestor != no_node; ancestor = m_parent[ancestor])
+    {
+        outside_length = std::max(outside_length, state.segment_lengths(ancestor).max());
+    }
+    const auto new_adjacent_length {dc.compute_length(adjacents[i][0], adjacents[i][1])};
+    VMove move;
+    search(node, i, next, adjacents, dc, next_lengths, old_segments_length, new_adjacent_length
+        , state, permanent_segment, outside_length, move);
+    return move;
+}
+
+template <typename Metric>
+void LinearQuadtree<Metric>::search(primitives::node_id_t node
+    , primitives::point_id_t i
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+    , const DistanceCalculator<Metric>& dc
+    , const std::vector<primitives::length_t>& next_lengths
+    , primitives::length_t old_segments_length
+    , primitives::length_t new_adjacent_length
+    , const SegmentState& state
+    , const Segment& permanent_segment
+    , primitives::length_t outside_length
+    , VMove& move) const
+{
+    const bool has_permanent {permanent_segment.length > 0};
+    const bool removes_permanent_adjacent {has_permanent
+        and (permanent_segment.same(i, adjacents[i][0]) or permanent_segment.same(i, adjacents[i][1]))};
+    if (removes_permanent_adjacent)
+    {
+        return;
+    }
+    if (is_leaf(node))
+    {
+        search_points(m_points.data() + m_point_begin[node], m_points.data() + m_point_end[node], i
+            , next, dc, next_lengths, old_segments_length, new_adjacent_length, permanent_segment, move);
+        return;
+    }
+
+    // Children are pruned as in Node::search.
+    constexpr primitives::space_t rounding_slack {2};
+    const auto x {dc.x(i)};
+    const auto y {dc.y(i)};
+    const auto outside_child_length {std::max(outside_length, state.segment_lengths(node).max())};
+    std::array<std::pair<primitives::space_t, primitives::node_id_t>, 4> children;
+    size_t child_count {0};
+    for (auto child {node + 1}; child < m_subtree_end[node]; child = m_subtree_end[child])
+    {
+        // insertion by distance.
+        auto c {child_count++};
+        const auto child_distance_squared {distance_squared(child, x, y)};
+        for (; c > 0 and children[c - 1].first > child_distance_squared; --c)
+        {
+            children[c] = children[c - 1];
+        }
+        children[c] = {child_distance_squared, child};
+    }
+    for (size_t c {0}; c < child_count; ++c)
+    {
+        const auto& [child_distance_squared, child] = children[c];
+        const auto max_next_length {std::max(outside_child_length, state.max_segment_length(child))};
+        const auto max_length {(static_cast<primitives::space_t>(old_segments_length)
+            - static_cast<primitives::space_t>(new_adjacent_length)
+            - static_cast<primitives::space_t>(move.improvement)) / 2
+            + static_cast<primitives::space_t>(max_next_length) + rounding_slack};
+        if (max_length < 0)
+        {
+            continue;
+        }
+        if constexpr (Metric::planar)
+        {
+            const auto max_distance {Metric::radius(max_length)};
+            if (child_distance_squared > max_distance * max_distance)
+            {
+                continue;
+            }
+        }
+        search(child, i, next, adjacents, dc, next_lengths, old_segments_length, new_adjacent_length
+            , state, permanent_segment, outside_child_length, move);
+    }
+}
+
+template <typename Metric>
+void LinearQuadtree<Metric>::nearest(primitives::point_id_t i, const DistanceCalculator<Metric>& dc
+    , const PointSubset<Metric>& subset, NearestPoints& nearest_points) const
+{
+    if (not m_parent.empty())
+    {
+        nearest(0, i, dc, subset, nearest_points);
+    }
+}
+
+template <typename Metric>
+void LinearQuadtree<Metric>::nearest(primitives::node_id_t node, primitives::point_id_t i, const DistanceCalculator<Metric>& dc
+    , const PointSubset<Metric>& subset, NearestPoints& nearest_points) const
+{
+    const auto x {dc.x(i)};
+    const auto y {dc.y(i)};
+    if (is_leaf(node))
+    {
+        for (auto point {m_point_begin[node]}; point < m_point_end[node]; ++point)
+        {
+            const auto p {m_points[point]};
+            if (p != i and subset.contains(p))
+            {
+                const auto dx {dc.x(p) - x};
+                const auto dy {dc.y(p) - y};
+                nearest_points.push(dx * dx + dy * dy, p);
+            }
+        }
+        return;
+    }
+    // as in search, children are visited nearest first.
+    std::array<std::pair<primitives::space_t, primitives::node_id_t>, 4> children;
+    size_t child_count {0};
+    for (auto child {node + 1}; child < m_subtree_end[node]; child = m_subtree_end[child])
+    {
+        if (subset.count(child) > 0)
+        {
+            auto c {child_count++};
+            const auto child_distance_squared {distance_squared(child, x, y)};
+            for (; c > 0 and children[c - 1].first > child_distance_squared; --c)
+            {
+                children[c] = children[c - 1];
+            }
+            children[c] = {child_distance_squared, child};
+        }
+    }
+    for (size_t c {0}; c < child_count; ++c)
+    {
+        const auto& [child_distance_squared, child] = children[c];
+        if (child_distance_squared > nearest_points.bound())
+        {
+            return;
+        }
+        nearest(child, i, dc, subset, nearest_points);
+    }
+}
+
+template <typename Metric>
+void LinearQuadtree<Metric>::search_perturbation(primitives::node_id_t node
+    , primitives::point_id_t i
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<primitives::length_t>& next_lengths
+    , const DistanceCalculator<Metric>& dc
+    , primitives::length_t min_adjacent_length
+    , primitives::length_t new_adjacent_length
+    , TopMoves& perturbations) const
+{
+    // as in Node::search_perturbation, points below the leaves are searched with the lax criterion.
+    if (not is_leaf(node))
+    {
+        search_perturbation_lax(node, i, next, next_lengths, dc, min_adjacent_length, new_adjacent_length, perturbations);
+        return;
+    }
+    for (auto point {m_point_begin[node]}; point < m_point_end[node]; ++point)
+    {
+        const auto p {m_points[point]};
+        if (p == i or next[p] == i)
+        {
+            continue;
+        }
+        auto min_new_length
+        {
+            std::min(
+                {
+                    dc.compute_length(i, p)
+                    , dc.compute_length(i, next[p])
+                    , new_adjacent_length
+                }
+            )
+        };
+        const auto min_old_length = std::min(min_adjacent_length, next_lengths[p]);
+        if (min_new_length < min_old_length)
+        {
+            auto improvement {min_old_length - min_new_length};
+            perturbations.push({i, p, improvement});
+        }
+    }
+}
+
+template <typename Metric>
+void LinearQuadtree<Metric>::search_perturbation_lax(primitives::node_id_t node
+    , primitives::point_id_t i
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<primitives::length_t>& next_lengths
+    , const DistanceCalculator<Metric>& dc
+    , primitives::length_t max_adjacent_length
+    , primitives::length_t new_adjacent_length
+    , TopMoves& perturbations) const
+{
+    for (auto point {m_point_begin[node]}; point < m_point_end[node]; ++point)
+    {
+        const auto p {m_points[point]};
+        if (p == i or next[p] == i)
+        {
+            continue;
+        }
+        auto min_new_length
+        {
+            std::min(
+                {
+                    dc.compute_length(i, p)
+                    , dc.compute_length(i, next[p])
+                    , new_adjacent_length
+                }
+            )
+        };
+        const auto max_old_length = std::max(max_adjacent_length, next_lengths[p]);
+        if (min_new_length < max_old_length)
+        {
+            auto improvement {max_old_length - min_new_length};
+            perturbations.push({i, p, improvement});
+        }
+    }
+}
+
+template <typename Metric>
+primitives::node_id_t LinearQuadtree<Metric>::ancestor(primitives::point_id_t i, primitives::depth_t depth) const
+{
+    auto node {m_leaf[i]};
+    while (m_top_depth[node] > depth)
+    {
+        node = m_parent[node];
+    }
+    return node;
+}
+
+template <typename Metric>
+void LinearQuadtree<Metric>::add_segment(const Segment& s, SegmentState& state) const
+{
+    const auto path {morton_keys::segment_insertion_path(m_morton_keys[s.min], m_morton_keys[s.max])};
+    auto node {ancestor(s.min, path.depth)};
+    state.segment_lengths(node).insert(s.length);
+    // ancestor max segment lengths are at least as long as those of their descendants.
+    for (; node != no_node and state.max_segment_length(node) < s.length; node = m_parent[node])
+    {
+        state.max_segment_length(node, s.length);
+    }
+}
+
+template <typename Metric>
+void LinearQuadtree<Metric>::remove_segment(const Segment& s, SegmentState& state) const
+{
+    const auto path {morton_keys::segment_insertion_path(m_morton_keys[s.min], m_morton_keys[s.max])};
+    auto node {ancestor(s.min, path.depth)};
+    auto& segment_lengths {state.segment_lengths(node)};
+    if (segment_lengths.empty())
+    {
+        std::cout << __func__
+            << ": error: tried to erase a length that does not exist."
+            << std::endl;
+        std::abort();
+    }
+    if (s.length > state.max_segment_length(node))
+    {
+        std::cout << __func__
+            << ": error: attempted to remove a segment length longer than the maximum."
+            << std::endl;
+        std::abort();
+    }
+    segment_lengths.remove(s.length);
+    // stops as soon as a max segment length is unchanged.
+    for (; node != no_node; node = m_parent[node])
+    {
+        const auto max_segment_length {state.max_segment_length(node)};
+        if (s.length < max_segment_length)
+        {
+            return;
+        }
+        auto new_max_segment_length {state.segment_lengths(node).max()};
+        for (auto child {node + 1}; child < m_subtree_end[node]; child = m_subtree_end[child])
+        {
+            new_max_segment_length = std::max(new_max_segment_length, state.max_segment_length(child));
+        }
+        state.max_segment_length(node, new_max_segment_length);
+        if (new_max_segment_length == max_segment_length)
+        {
+            return;
+        }
+    }
+}
+
+// for every metric policy.
+#define POINT_QUADTREE_LINEAR_QUADTREE_INSTANTIATE(Metric) \
+    template class LinearQuadtree<Metric>;
+METRIC_FOR_EACH_POLICY(POINT_QUADTREE_LINEAR_QUADTREE_INSTANTIATE)
+#undef POINT_QUADTREE_LINEAR_QUADTREE_INSTANTIATE
+
+} // namespace point_quadtree
@@ -0,0 +1,167 @@
+#pragma once
+
+// Quadtree engine without pointers: nodes are stored in contiguous arrays in depth-first Morton order,
+//  so the subtree of a node is the range of nodes from the node up to its subtree end.
+// Points are stored in one array sorted by Morton key, and every node refers to the range of
+//  points under it.
+// Nodes with few points are leaves, which hold their points in a bucket.
+// The tree is built top-down over the sorted points; the subtrees below the top levels are built in parallel.
+// Chains of single-child nodes are collapsed into their deepest node, which keeps the depth of the
+//  top of the chain. Every level of the chain holds the same points and no segments, so only
+//  expand needs to tell the levels apart.
+
+#include "Domain.h"
+#include "Quadtree.h"
+#include "morton_keys.h"
+#include <ThreadPool.h>
+
+#include <cstdint> // uint8_t
+#include <vector>
+
+namespace point_quadtree {
+
+template <typename Metric>
+class LinearQuadtree : public Quadtree<Metric>
+{
+public:
+    using Quadtree<Metric>::no_node;
+
+    // Nodes with up to leaf_capacity points are leaves; see point_quadtree::is_leaf.
+    LinearQuadtree(const std::vector<primitives::morton_key_t>& morton_keys, const Domain& domain
+        , size_t leaf_capacity, ThreadPool& thread_pool);
+
+    size_t size() const override { return m_parent.size(); }
+    primitives::node_id_t leaf(primitives::point_id_t i) const override { return m_leaf[i]; }
+    primitives::node_id_t parent(primitives::node_id_t node) const override { return m_parent[node]; }
+
+    void nearest(primitives::point_id_t i, const DistanceCalculator<Metric>&
+        , const PointSubset<Metric>&, NearestPoints& nearest_points) const override;
+
+    primitives::node_id_t expand(primitives::node_id_t node
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t old_segments_length, const SegmentState&) const override;
+    primitives::node_id_t expand_simple(primitives::node_id_t node
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t min_radius, const SegmentState&) const override;
+
+    VMove search(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+        , const DistanceCalculator<Metric>&
+        , const std::vector<primitives::length_t>& next_lengths
+        , primitives::length_t old_segments_length
+        , const SegmentState&
+        , const Segment& permanent_segment) const override;
+
+    void search_perturbation(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<primitives::length_t>& next_lengths
+        , const DistanceCalculator<Metric>&
+        , primitives::length_t min_adjacent_length
+        , primitives::length_t new_adjacent_length
+        , TopMoves& perturbations) const override;
+    void search_perturbation_lax(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<primitives::length_t>& next_lengths
+        , const DistanceCalculator<Metric>&
+        , primitives::length_t max_adjacent_length
+        , primitives::length_t new_adjacent_length
+        , TopMoves& perturbations) const override;
+
+    void add_segment(const Segment&, SegmentState&) const override;
+    void remove_segment(const Segment&, SegmentState&) const override;
+
+private:
+    const std::vector<primitives::morton_key_t>& m_morton_keys;
+    const Domain m_domain;
+    const size_t m_leaf_capacity {0};
+
+    std::vector<primitives::point_id_t> m_points; // sorted by Morton key.
+    std::vector<primitives::node_id_t> m_leaf; // index corresponds to point id.
+
+    // index corresponds to node index.
+    std::vector<primitives::node_id_t> m_parent;
+    std::vector<primitives::node_id_t> m_subtree_end; // one past the last node in the subtree.
+    std::vector<primitives::point_id_t> m_point_begin; // into m_points.
+    std::vector<primitives::point_id_t> m_point_end;
+    std::vector<primitives::grid_t> m_x; // grid coordinates at the node depth.
+    std::vector<primitives::grid_t> m_y;
+    std::vector<uint8_t> m_depth;
+    std::vector<uint8_t> m_top_depth; // depth of the top of a collapsed chain.
+
+    // Subtree that is built by its own task; see build.
+    struct BuildTask
+    {
+        primitives::node_id_t node {0}; // first node of the subtree.
+        primitives::node_id_t node_count {0};
+        primitives::node_id_t parent {0};
+        primitives::depth_t depth {0};
+        primitives::grid_t x {0};
+        primitives::grid_t y {0};
+        primitives::point_id_t point_begin {0};
+        primitives::point_id_t point_end {0};
+    };
+    // Subtrees that start at task_depth or deeper are built in parallel.
+    static constexpr primitives::depth_t task_depth {3};
+
+    void build(ThreadPool& thread_pool);
+    // Descends depth, x and y down the chain of single children that hold the points in [point_begin, point_end).
+    void collapse(primitives::depth_t& depth, primitives::grid_t& x, primitives::grid_t& y
+        , primitives::point_id_t point_begin, primitives::point_id_t point_end) const;
+    // Appends the subtrees of the points in [point_begin, point_end) that start at task_depth to tasks,
+    //  in depth-first order; returns the number of nodes above them.
+    primitives::node_id_t collect_tasks(primitives::depth_t depth
+        , primitives::grid_t x, primitives::grid_t y
+        , primitives::point_id_t point_begin, primitives::point_id_t point_end
+        , std::vector<BuildTask>& tasks) const;
+    primitives::node_id_t count_nodes(primitives::depth_t depth
+        , primitives::point_id_t point_begin, primitives::point_id_t point_end) const;
+    // Creates the nodes of the subtree of the points in [point_begin, point_end) from index node on,
+    //  and returns one past its last node.
+    // If task is given, subtrees that start at task_depth are not built; the tasks from *task on,
+    //  counted and in the same order, are given their node ranges instead.
+    primitives::node_id_t build(primitives::node_id_t node, primitives::node_id_t parent, primitives::depth_t depth
+        , primitives::grid_t x, primitives::grid_t y
+        , primitives::point_id_t point_begin, primitives::point_id_t point_end
+        , BuildTask** task = nullptr);
+    // Like expand, from depth of the chain of node.
+    primitives::node_id_t expand(primitives::node_id_t node, primitives::depth_t depth
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t radius, const SegmentState&) const;
+
+    // whether the chain of node at depth encloses the circle with center x, y and a radius of Metric::radius(length);
+    //  never for non-planar metrics.
+    bool encloses(primitives::node_id_t node, primitives::depth_t depth
+        , primitives::space_t x, primitives::space_t y, primitives::space_t length) const;
+    bool is_leaf(primitives::node_id_t node) const { return m_subtree_end[node] == node + 1; }
+    // squared distance from x, y to the bounding box of node; 0 if inside.
+    primitives::space_t distance_squared(primitives::node_id_t node, primitives::space_t x, primitives::space_t y) const;
+    // squared distance from x, y to the nearest edge of the bounding box of the chain of node at depth,
+    //  for x, y inside of it.
+    primitives::space_t margin_squared(primitives::node_id_t node, primitives::depth_t depth
+        , primitives::space_t x, primitives::space_t y) const;
+    // node at depth above point i.
+    primitives::node_id_t ancestor(primitives::point_id_t i, primitives::depth_t depth) const;
+
+    void nearest(primitives::node_id_t node, primitives::point_id_t i, const DistanceCalculator<Metric>&
+        , const PointSubset<Metric>&, NearestPoints& nearest_points) const;
+
+    // outside_length: max length of segments from points under node to points outside of it.
+    void search(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+        , const DistanceCalculator<Metric>&
+        , const std::vector<primitives::length_t>& next_lengths
+        , primitives::length_t old_segments_length
+        , primitives::length_t new_adjacent_length
+        , const SegmentState&
+        , const Segment& permanent_segment
+        , primitives::length_t outside_length
+        , VMove& move) const;
+};
+
+} // namespace point_quadtree
@@ -0,0 +1,68 @@
+#pragma once
+
+// Keeps the K points nearest to a query point seen so far, in a bounded max-heap.
+// Ties are broken by point id, so the kept points do not depend on the order they are pushed in.
+
+#include <primitives.h>
+
+#include <algorithm> // push_heap, pop_heap, sort_heap
+#include <limits> // numeric_limits
+#include <utility> // pair
+#include <vector>
+
+namespace point_quadtree {
+
+class NearestPoints
+{
+public:
+    NearestPoints(size_t capacity) : m_capacity(capacity) { m_points.reserve(capacity); }
+
+    size_t size() const { return m_points.size(); }
+
+    // squared distance beyond which pushed points are not kept.
+    primitives::space_t bound() const
+    {
+        if (m_points.size() < m_capacity)
+        {
+            return std::numeric_limits<primitives::space_t>::max();
+        }
+        return m_points.front().first;
+    }
+
+    void push(primitives::space_t distance_squared, primitives::point_id_t i)
+    {
+        const Entry entry {distance_squared, i};
+        if (m_points.size() < m_capacity)
+        {
+            m_points.push_back(entry);
+            std::push_heap(std::begin(m_points), std::end(m_points));
+            return;
+        }
+        if (m_capacity == 0 or not (entry < m_points.front()))
+        {
+            return;
+        }
+        std::pop_heap(std::begin(m_points), std::end(m_points));
+        m_points.back() = entry;
+        std::push_heap(std::begin(m_points), std::end(m_points));
+    }
+
+    // Appends the kept points to points, nearest first, and empties this.
+    void take(std::vector<primitives::point_id_t>& points)
+    {
+        std::sort_heap(std::begin(m_points), std::end(m_points));
+        for (const auto& entry : m_points)
+        {
+            points.push_back(entry.second);
+        }
+        m_points.clear();
+    }
+
+private:
+    using Entry = std::pair<primitives::space_t, primitives::point_id_t>;
+
+    const size_t m_capacity {0};
+    std::vector<Entry> m_points; // max-heap: the farthest kept point is at front.
+};
+
+} // namespace point_quadtree
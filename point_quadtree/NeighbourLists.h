@@ -0,0 +1,58 @@
+#pragma once
+
+// The K nearest points of every point, nearest first, in compressed sparse row form:
+//  the neighbours of point i are at [offsets[i], offsets[i + 1]) of one array.
+
+#include "NearestPoints.h"
+#include "PointSubset.h"
+#include "Quadtree.h"
+#include <DistanceCalculator.h>
+#include <ThreadPool.h>
+#include <primitives.h>
+
+#include <numeric> // partial_sum
+#include <vector>
+
+namespace point_quadtree {
+
+class NeighbourLists
+{
+public:
+    // Lists are found with nearest point queries, in parallel chunks of points.
+    template <typename Metric>
+    NeighbourLists(const Quadtree<Metric>& quadtree, const DistanceCalculator<Metric>& dc
+        , primitives::point_id_t point_count, size_t k, ThreadPool& thread_pool)
+        : m_offsets(point_count + 1, 0)
+    {
+        const PointSubset<Metric> all_points(quadtree, point_count, true);
+        std::vector<std::vector<primitives::point_id_t>> chunk_neighbours(thread_pool.chunk_count(point_count));
+        thread_pool.for_each_chunk(point_count, [&](size_t begin, size_t end, size_t chunk)
+        {
+            NearestPoints nearest(k);
+            auto& neighbours {chunk_neighbours[chunk]};
+            for (auto i {static_cast<primitives::point_id_t>(begin)}; i < end; ++i)
+            {
+                quadtree.nearest(i, dc, all_points, nearest);
+                m_offsets[i + 1] = static_cast<primitives::point_id_t>(nearest.size());
+                nearest.take(neighbours);
+            }
+        });
+        // chunks are in point order, so neighbour counts add up to offsets.
+        std::partial_sum(std::cbegin(m_offsets), std::cend(m_offsets), std::begin(m_offsets));
+        m_neighbours.reserve(m_offsets.back());
+        for (const auto& neighbours : chunk_neighbours)
+        {
+            m_neighbours.insert(std::end(m_neighbours), std::cbegin(neighbours), std::cend(neighbours));
+        }
+    }
+
+    size_t size() const { return m_offsets.size() - 1; }
+    const primitives::point_id_t* begin(primitives::point_id_t i) const { return m_neighbours.data() + m_offsets[i]; }
+    const primitives::point_id_t* end(primitives::point_id_t i) const { return m_neighbours.data() + m_offsets[i + 1]; }
+
+private:
+    std::vector<primitives::point_id_t> m_offsets; // index corresponds to point id; one more for the end.
+    std::vector<primitives::point_id_t> m_neighbours;
+};
+
+} // namespace point_quadtree
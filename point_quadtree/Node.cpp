@@ -1,51 +1,45 @@
 #include "Node.h"
 
+#include "PointSubset.h"
+#include "search_points.h"
+
 namespace point_quadtree {
 
 Node::Node(Node* parent, const Domain& domain
-    , primitives::grid_t x, primitives::grid_t y, primitives::depth_t depth)
+    , primitives::grid_t x, primitives::grid_t y, primitives::depth_t depth
+    , primitives::node_id_t index)
     : m_parent(parent)
+    , m_index(index)
     , m_x(x)
     , m_y(y)
-    , m_xmin(x * domain.xdim(depth))
-    , m_ymin(y * domain.ydim(depth))
-    , m_xmax((x + 1) * domain.xdim(depth))
-    , m_ymax((y + 1) * domain.ydim(depth))
+    , m_xmin(domain.xmin() + x * domain.xdim(depth))
+    , m_ymin(domain.ymin() + y * domain.ydim(depth))
+    , m_xmax(domain.xmin() + (x + 1) * domain.xdim(depth))
+    , m_ymax(domain.ymin() + (y + 1) * domain.ydim(depth))
 {
 }
 
-void Node::reset_max_segment_lengths()
+size_t Node::size() const
 {
-    m_max_segment_length = 0;
+    size_t size {1};
     for (const auto& unique_ptr : m_children)
     {
         if (unique_ptr)
         {
-            unique_ptr->reset_max_segment_lengths();
-        }
-    }
-}
-
-void Node::reset_segments()
-{
-    m_max_segment_length = 0;
-    m_segment_lengths.clear();
-    for (const auto& unique_ptr : m_children)
-    {
-        if (unique_ptr)
-        {
-            unique_ptr->reset_segments();
+            size += unique_ptr->size();
         }
     }
+    return size;
 }
 
+template <typename Metric>
 void Node::search_perturbation(const primitives::point_id_t i
     , const std::vector<primitives::point_id_t>& next
     , const std::vector<primitives::length_t>& next_lengths
-    , const DistanceCalculator& dc
+    , const DistanceCalculator<Metric>& dc
     , const primitives::length_t min_adjacent_length
     , const primitives::length_t new_adjacent_length
-    , std::vector<VMove>& perturbations) const
+    , TopMoves& perturbations) const
 {
     for (auto p : m_points)
     {
@@ -67,7 +61,7 @@ void Node::search_perturbation(const primitives::point_id_t i
         if (min_new_length < min_old_length)
         {
             auto improvement {min_old_length - min_new_length};
-            perturbations.push_back({i, p, improvement});
+            perturbations.push({i, p, improvement});
         }
     }
     for (const auto& unique_ptr : m_children)
@@ -79,13 +73,14 @@ void Node::search_perturbation(const primitives::point_id_t i
     }
 }
 
+template <typename Metric>
 void Node::search_perturbation_lax(const primitives::point_id_t i
     , const std::vector<primitives::point_id_t>& next
     , const std::vector<primitives::length_t>& next_lengths
-    , const DistanceCalculator& dc
+    , const DistanceCalculator<Metric>& dc
     , const primitives::length_t max_adjacent_length
     , const primitives::length_t new_adjacent_length
-    , std::vector<VMove>& perturbations) const
+    , TopMoves& perturbations) const
 {
     for (auto p : m_points)
     {
@@ -107,7 +102,7 @@ void Node::search_perturbation_lax(const primitives::point_id_t i
         if (min_new_length < max_old_length)
         {
             auto improvement {max_old_length - min_new_length};
-            perturbations.push_back({i, p, improvement});
+            perturbations.push({i, p, improvement});
         }
     }
     for (const auto& unique_ptr : m_children)
@@ -119,56 +114,14 @@ void Node::search_perturbation_lax(const primitives::point_id_t i
     }
 }
 
-VMove Node::search(primitives::point_id_t i
-    , const std::vector<primitives::point_id_t>& next
-    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
-    , const DistanceCalculator& dc
-    , const std::vector<primitives::length_t>& next_lengths
-    , primitives::length_t old_segments_length) const
-{
-    VMove move;
-    for (auto p : m_points)
-    {
-        if (p == i or next[p] == i)
-        {
-            continue;
-        }
-        auto reduction {old_segments_length + next_lengths[p]};
-        auto new_length {dc.compute_length(i, p)};
-        if (new_length > reduction)
-        {
-            continue;
-        }
-        new_length += dc.compute_length(i, next[p]);
-        if (new_length > reduction)
-        {
-            continue;
-        }
-        new_length += dc.compute_length(adjacents[i][0], adjacents[i][1]);
-        if (new_length < reduction)
-        {
-            auto improvement {reduction - new_length};
-            move.apply({i, p, improvement});
-        }
-    }
-    for (const auto& unique_ptr : m_children)
-    {
-        if (unique_ptr)
-        {
-            move.apply(unique_ptr->search(
-                i, next, adjacents, dc, next_lengths, old_segments_length));
-        }
-    }
-    return move;
-}
-
+template <typename Metric>
 void Node::search_perturbation_lateral(const primitives::point_id_t i
     , const std::vector<primitives::point_id_t>& next
     , const std::vector<primitives::length_t>& next_lengths
-    , const DistanceCalculator& dc
+    , const DistanceCalculator<Metric>& dc
     , const primitives::length_t old_adjacent_length
     , const primitives::length_t new_adjacent_length
-    , std::vector<VMove>& perturbations) const
+    , TopMoves& perturbations) const
 {
     for (auto p : m_points)
     {
@@ -185,7 +138,7 @@ void Node::search_perturbation_lateral(const primitives::point_id_t i
         const auto old_length = old_adjacent_length + next_lengths[p];
         if (new_length == old_length)
         {
-            perturbations.push_back({i, p});
+            perturbations.push({i, p});
         }
     }
     for (const auto& unique_ptr : m_children)
@@ -197,141 +150,252 @@ void Node::search_perturbation_lateral(const primitives::point_id_t i
     }
 }
 
+template <typename Metric>
+VMove Node::search(primitives::point_id_t i
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+    , const DistanceCalculator<Metric>& dc
+    , const std::vector<primitives::length_t>& next_lengths
+    , primitives::length_t old_segments_length
+    , const SegmentState& state) const
+{
+    return search(i, next, adjacents, dc, next_lengths, old_segments_length, state, Segment());
+}
+
+template <typename Metric>
 VMove Node::search(primitives::point_id_t i
     , const std::vector<primitives::point_id_t>& next
     , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
-    , const DistanceCalculator& dc
+    , const DistanceCalculator<Metric>& dc
     , const std::vector<primitives::length_t>& next_lengths
     , primitives::length_t old_segments_length
+    , const SegmentState& state
     , const Segment& permanent_segment) const
 {
+    // segments from points under this node to points outside of it are held by ancestors.
+    primitives::length_t outside_length {0};
+    for (auto node {m_parent}; node; node = node->parent())
+    {
+        outside_length = std::max(outside_length, state.segment_lengths(node->index()).max());
+    }
+    const auto new_adjacent_length {dc.compute_length(adjacents[i][0], adjacents[i][1])};
     VMove move;
-    for (auto p : m_points)
+    search(i, next, adjacents, dc, next_lengths, old_segments_length, new_adjacent_length
+        , state, permanent_segment, outside_length, move);
+    return move;
+}
+
+template <typename Metric>
+void Node::search(primitives::point_id_t i
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+    , const DistanceCalculator<Metric>& dc
+    , const std::vector<primitives::length_t>& next_lengths
+    , primitives::length_t old_segments_length
+    , primitives::length_t new_adjacent_length
+    , const SegmentState& state
+    , const Segment& permanent_segment
+    , primitives::length_t outside_length
+    , VMove& move) const
+{
+    const bool has_permanent {permanent_segment.length > 0};
+    const bool removes_permanent_adjacent {has_permanent
+        and (permanent_segment.same(i, adjacents[i][0]) or permanent_segment.same(i, adjacents[i][1]))};
+    if (removes_permanent_adjacent)
     {
-        if (p == i or next[p] == i)
+        return;
+    }
+    search_points(m_points.data(), m_points.data() + m_points.size(), i
+        , next, dc, next_lengths, old_segments_length, new_adjacent_length, permanent_segment, move);
+
+    // A move to p improves on move only if
+    //  d(i, p) + d(i, next[p]) < old_segments_length - new_adjacent_length - move.improvement + d(p, next[p]).
+    // By the triangle inequality, d(i, next[p]) >= d(i, p) - d(p, next[p]), so it is necessary that
+    //  d(i, p) < (old_segments_length - new_adjacent_length - move.improvement) / 2 + d(p, next[p]).
+    // d(p, next[p]) is at most the longest segment under the child of p or held by this node or its ancestors;
+    //  only the segments held by the child subtree differ between children.
+    // The slack covers rounding of lengths, and Metric::radius converts lengths to coordinate distances.
+    // Without a planar metric, every child is searched.
+    constexpr primitives::space_t rounding_slack {2};
+    const auto x {dc.x(i)};
+    const auto y {dc.y(i)};
+    const auto outside_child_length {std::max(outside_length, state.segment_lengths(m_index).max())};
+    std::array<std::pair<primitives::space_t, const Node*>, 4> children;
+    size_t child_count {0};
+    for (const auto& unique_ptr : m_children)
+    {
+        if (unique_ptr)
         {
-            continue;
+            // insertion by distance.
+            auto c {child_count++};
+            const auto distance_squared {unique_ptr->distance_squared(x, y)};
+            for (; c > 0 and children[c - 1].first > distance_squared; --c)
+            {
+                children[c] = children[c - 1];
+            }
+            children[c] = {distance_squared, unique_ptr.get()};
         }
-        const bool removes_permanent {permanent_segment.same(p, next[p])
-            or permanent_segment.same(i, adjacents[i][0])
-            or permanent_segment.same(i, adjacents[i][1])};
-        if (removes_permanent)
+    }
+    for (size_t c {0}; c < child_count; ++c)
+    {
+        const auto& [distance_squared, child] = children[c];
+        const auto max_next_length {std::max(outside_child_length, child->max_segment_length(state))};
+        const auto max_length {(static_cast<primitives::space_t>(old_segments_length)
+            - static_cast<primitives::space_t>(new_adjacent_length)
+            - static_cast<primitives::space_t>(move.improvement)) / 2
+            + static_cast<primitives::space_t>(max_next_length) + rounding_slack};
+        if (max_length < 0)
         {
             continue;
         }
-        auto reduction {old_segments_length + next_lengths[p]};
-        auto new_length {dc.compute_length(i, p)};
-        if (new_length > reduction)
+        if constexpr (Metric::planar)
         {
-            continue;
+            const auto max_distance {Metric::radius(max_length)};
+            if (distance_squared > max_distance * max_distance)
+            {
+                continue;
+            }
         }
-        new_length += dc.compute_length(i, next[p]);
-        if (new_length > reduction)
+        child->search(i, next, adjacents, dc, next_lengths, old_segments_length, new_adjacent_length
+            , state, permanent_segment, outside_child_length, move);
+    }
+}
+
+template <typename Metric>
+void Node::nearest(primitives::point_id_t i, const DistanceCalculator<Metric>& dc
+    , const PointSubset<Metric>& subset, NearestPoints& nearest_points) const
+{
+    const auto x {dc.x(i)};
+    const auto y {dc.y(i)};
+    for (auto p : m_points)
+    {
+        if (p != i and subset.contains(p))
         {
-            continue;
+            const auto dx {dc.x(p) - x};
+            const auto dy {dc.y(p) - y};
+            nearest_points.push(dx * dx + dy * dy, p);
         }
-        new_length += dc.compute_length(adjacents[i][0], adjacents[i][1]);
-        if (new_length < reduction)
+    }
+    // as in search, children are visited nearest first.
+    std::array<std::pair<primitives::space_t, const Node*>, 4> children;
+    size_t child_count {0};
+    for (const auto& unique_ptr : m_children)
+    {
+        if (unique_ptr and subset.count(unique_ptr->index()) > 0)
         {
-            auto improvement {reduction - new_length};
-            move.apply({i, p, improvement});
+            auto c {child_count++};
+            const auto distance_squared {unique_ptr->distance_squared(x, y)};
+            for (; c > 0 and children[c - 1].first > distance_squared; --c)
+            {
+                children[c] = children[c - 1];
+            }
+            children[c] = {distance_squared, unique_ptr.get()};
         }
     }
-    for (const auto& unique_ptr : m_children)
+    for (size_t c {0}; c < child_count; ++c)
     {
-        if (unique_ptr)
+        const auto& [distance_squared, child] = children[c];
+        if (distance_squared > nearest_points.bound())
         {
-            move.apply(unique_ptr->search(
-                i, next, adjacents, dc, next_lengths, old_segments_length));
+            return;
         }
+        child->nearest(i, dc, subset, nearest_points);
     }
-    return move;
 }
 
-void Node::remove_segment(
-    std::vector<primitives::quadrant_t>::const_iterator next_quadrant
-    , const std::vector<primitives::quadrant_t>::const_iterator quadrant_end
-    , primitives::length_t length)
+primitives::space_t Node::distance_squared(primitives::space_t x, primitives::space_t y) const
 {
-    const bool remove_here {next_quadrant == quadrant_end};
+    const auto dx {std::max({m_xmin - x, primitives::space_t{0}, x - m_xmax})};
+    const auto dy {std::max({m_ymin - y, primitives::space_t{0}, y - m_ymax})};
+    return dx * dx + dy * dy;
+}
+
+bool Node::remove_segment(const morton_keys::SegmentPath& path
+    , primitives::length_t length
+    , SegmentState& state
+    , primitives::depth_t depth) const
+{
+    const auto max_segment_length {state.max_segment_length(m_index)};
+    if (length > max_segment_length)
+    {
+        std::cout << __func__
+            << ": error: attempted to remove a segment length longer than the maximum."
+            << std::endl;
+        std::abort();
+    }
+    auto& segment_lengths {state.segment_lengths(m_index)};
+    const bool remove_here {depth == path.depth or leaf()};
     if (remove_here)
     {
-        const auto it {std::find(std::cbegin(m_segment_lengths)
-            , std::cend(m_segment_lengths)
-            , length)};
-        if (it == std::cend(m_segment_lengths))
+        if (segment_lengths.empty())
         {
             std::cout << __func__
                 << ": error: tried to erase a length that does not exist."
                 << std::endl;
             std::abort();
         }
-        m_segment_lengths.erase(it);
+        segment_lengths.remove(length);
     }
     else
     {
-        const auto& child {m_children[*next_quadrant]};
+        const auto& child {m_children[path.quadrant(depth)]};
         if (not child)
         {
             std::cout << __func__
                 << ": error: child does not exist for segment pathway." << std::endl;
             std::abort();
         }
-        child->remove_segment(++next_quadrant, quadrant_end, length);
+        const bool child_max_changed {child->remove_segment(path, length, state, depth + 1)};
+        if (not child_max_changed)
+        {
+            return false;
+        }
     }
-    if (length > m_max_segment_length)
+    if (length < max_segment_length)
     {
-        std::cout << __func__
-            << ": error: attempted to remove a segment length longer than the maximum."
-            << std::endl;
-        std::abort();
+        return false;
     }
-    const bool need_update {length == m_max_segment_length};
-    if (need_update)
+    auto new_max_segment_length {segment_lengths.max()};
+    for (const auto& unique_ptr : m_children)
     {
-        if (m_segment_lengths.size() > 0)
+        if (unique_ptr)
         {
-            m_max_segment_length = *std::max_element(std::cbegin(m_segment_lengths)
-                , std::cend(m_segment_lengths));
-        }
-        for (const auto& unique_ptr : m_children)
-        {
-            if (unique_ptr)
-            {
-                m_max_segment_length = std::max(m_max_segment_length
-                    , unique_ptr->max_segment_length());
-            }
+            new_max_segment_length = std::max(new_max_segment_length
+                , unique_ptr->max_segment_length(state));
         }
     }
+    state.max_segment_length(m_index, new_max_segment_length);
+    return new_max_segment_length != max_segment_length;
 }
 
-void Node::add_segment(const Segment& s, const std::vector<primitives::morton_key_t>& morton_keys)
+void Node::add_segment(const Segment& s, const std::vector<primitives::morton_key_t>& morton_keys
+    , SegmentState& state) const
 {
-    const auto insertion_path {point_quadtree::morton_keys::segment_insertion_path(morton_keys[s.min], morton_keys[s.max])};
-    add_segment(std::cbegin(insertion_path), std::cend(insertion_path), s.length);
+    add_segment(morton_keys::segment_insertion_path(morton_keys[s.min], morton_keys[s.max]), s.length, state);
 }
 
-void Node::add_segment(std::vector<primitives::quadrant_t>::const_iterator next_quadrant
-    , const std::vector<primitives::quadrant_t>::const_iterator quadrant_end
-    , primitives::length_t length)
+void Node::add_segment(const morton_keys::SegmentPath& path
+    , primitives::length_t length
+    , SegmentState& state
+    , primitives::depth_t depth) const
 {
-    const bool add_here {next_quadrant == quadrant_end};
+    const bool add_here {depth == path.depth or leaf()};
     if (add_here)
     {
-        m_segment_lengths.push_back(length);
+        state.segment_lengths(m_index).insert(length);
     }
     else
     {
-        const auto& child {m_children[*next_quadrant]};
+        const auto& child {m_children[path.quadrant(depth)]};
         if (not child)
         {
             std::cout << __func__
                 << ": error: child does not exist for segment pathway." << std::endl;
             std::abort();
         }
-        child->add_segment(++next_quadrant, quadrant_end, length);
+        child->add_segment(path, length, state, depth + 1);
     }
-    m_max_segment_length = std::max(m_max_segment_length, length);
+    state.max_segment_length(m_index, std::max(state.max_segment_length(m_index), length));
 }
 
 void Node::insert(primitives::point_id_t i)
@@ -341,17 +405,19 @@ void Node::insert(primitives::point_id_t i)
 
 void Node::create_child(primitives::quadrant_t quadrant
     , const Domain& domain
-    , primitives::grid_t x, primitives::grid_t y, primitives::depth_t depth)
+    , primitives::grid_t x, primitives::grid_t y, primitives::depth_t depth
+    , primitives::node_id_t index)
 {
     if (m_children[quadrant])
     {
         return;
     }
-    m_children[quadrant] = std::make_unique<Node>(this, domain, x, y, depth);
+    m_children[quadrant] = std::make_unique<Node>(this, domain, x, y, depth, index);
 }
 
+template <typename Metric>
 const Node* Node::expand(primitives::space_t x, primitives::space_t y
-    , primitives::space_t old_segments_length) const
+    , primitives::space_t old_segments_length, const SegmentState& state) const
 {
     if (not m_parent)
     {
@@ -361,16 +427,21 @@ const Node* Node::expand(primitives::space_t x, primitives::space_t y
     auto margin_dx {std::min(x - m_xmin, m_xmax - x)};
     auto margin_dy {std::min(y - m_ymin, m_ymax - y)};
     auto margin_sq {margin_dx * margin_dx + margin_dy * margin_dy};
-    auto min_radius {old_segments_length + m_max_segment_length};
-    if (margin_sq >= min_radius * min_radius)
+    auto min_radius {old_segments_length + max_segment_length(state)};
+    if constexpr (Metric::planar)
     {
-        return this;
+        const auto radius {Metric::radius(min_radius)};
+        if (margin_sq >= radius * radius)
+        {
+            return this;
+        }
     }
-    return m_parent->expand(x, y, min_radius);
+    return m_parent->expand<Metric>(x, y, min_radius, state);
 }
 
+template <typename Metric>
 const Node* Node::expand_simple(primitives::space_t x, primitives::space_t y
-    , primitives::space_t min_radius) const
+    , primitives::space_t min_radius, const SegmentState& state) const
 {
     if (not m_parent)
     {
@@ -380,11 +451,64 @@ const Node* Node::expand_simple(primitives::space_t x, primitives::space_t y
     auto margin_dx {std::min(x - m_xmin, m_xmax - x)};
     auto margin_dy {std::min(y - m_ymin, m_ymax - y)};
     auto margin_sq {margin_dx * margin_dx + margin_dy * margin_dy};
-    if (margin_sq >= min_radius * min_radius)
+    if constexpr (Metric::planar)
     {
-        return this;
+        const auto radius {Metric::radius(min_radius)};
+        if (margin_sq >= radius * radius)
+        {
+            return this;
+        }
     }
-    return m_parent->expand(x, y, min_radius);
+    return m_parent->expand<Metric>(x, y, min_radius, state);
 }
 
+// member templates for every metric policy.
+#define POINT_QUADTREE_NODE_INSTANTIATE(Metric) \
+    template VMove Node::search(primitives::point_id_t \
+        , const std::vector<primitives::point_id_t>& \
+        , const std::vector<std::array<primitives::point_id_t, 2>>& \
+        , const DistanceCalculator<Metric>& \
+        , const std::vector<primitives::length_t>& \
+        , primitives::length_t \
+        , const SegmentState&) const; \
+    template VMove Node::search(primitives::point_id_t \
+        , const std::vector<primitives::point_id_t>& \
+        , const std::vector<std::array<primitives::point_id_t, 2>>& \
+        , const DistanceCalculator<Metric>& \
+        , const std::vector<primitives::length_t>& \
+        , primitives::length_t \
+        , const SegmentState& \
+        , const Segment&) const; \
+    template void Node::search_perturbation(primitives::point_id_t \
+        , const std::vector<primitives::point_id_t>& \
+        , const std::vector<primitives::length_t>& \
+        , const DistanceCalculator<Metric>& \
+        , primitives::length_t \
+        , primitives::length_t \
+        , TopMoves&) const; \
+    template void Node::search_perturbation_lax(primitives::point_id_t \
+        , const std::vector<primitives::point_id_t>& \
+        , const std::vector<primitives::length_t>& \
+        , const DistanceCalculator<Metric>& \
+        , primitives::length_t \
+        , primitives::length_t \
+        , TopMoves&) const; \
+    template void Node::search_perturbation_lateral(primitives::point_id_t \
+        , const std::vector<primitives::point_id_t>& \
+        , const std::vector<primitives::length_t>& \
+        , const DistanceCalculator<Metric>& \
+        , primitives::length_t \
+        , primitives::length_t \
+        , TopMoves&) const; \
+    template void Node::nearest(primitives::point_id_t, const DistanceCalculator<Metric>& \
+        , const PointSubset<Metric>&, NearestPoints&) const; \
+    template const Node* Node::expand<Metric>(primitives::space_t, primitives::space_t \
+        , primitives::space_t, const SegmentState&) const; \
+    template const Node* Node::expand_simple<Metric>(primitives::space_t, primitives::space_t \
+        , primitives::space_t, const SegmentState&) const;
+
+METRIC_FOR_EACH_POLICY(POINT_QUADTREE_NODE_INSTANTIATE)
+
+#undef POINT_QUADTREE_NODE_INSTANTIATE
+
 } // namespace point_quadtree
@@ -1,7 +1,11 @@
 #pragma once
 
 // Children are indexed by Morton key quadrant.
+// Segment lengths are not stored in nodes, but in a SegmentState indexed by node index.
 
+#include "NearestPoints.h"
+#include "SegmentState.h"
+#include "TopMoves.h"
 #include "VMove.h"
 #include "morton_keys.h"
 #include <DistanceCalculator.h>
@@ -20,25 +24,33 @@
 
 namespace point_quadtree {
 
+template <typename Metric>
+class PointSubset;
+
 class Node
 {
     using ChildArray = std::array<std::unique_ptr<Node>, 4>;
 public:
-    Node(Node* parent, const Domain&, primitives::grid_t x, primitives::grid_t y, primitives::depth_t);
+    Node(Node* parent, const Domain&, primitives::grid_t x, primitives::grid_t y, primitives::depth_t
+        , primitives::node_id_t index);
 
     const ChildArray& children() const { return m_children; }
     Node* child(primitives::quadrant_t q) { return m_children[q].get(); }
 
     const std::vector<primitives::point_id_t>& points() const { return m_points; }
+    // only leaves hold points; segments with both endpoints in a leaf are held by the leaf.
+    bool leaf() const { return not m_points.empty(); }
 
     Node* parent() { return m_parent; }
     const Node* parent() const { return m_parent; }
 
     void create_child(primitives::quadrant_t, const Domain&
-        , primitives::grid_t x, primitives::grid_t y, primitives::depth_t);
+        , primitives::grid_t x, primitives::grid_t y, primitives::depth_t
+        , primitives::node_id_t index);
 
-    void reset_max_segment_lengths();
-    void reset_segments();
+    primitives::node_id_t index() const { return m_index; }
+    // number of nodes in the subtree rooted at this node.
+    size_t size() const;
 
     primitives::grid_t x() const { return m_x; }
     primitives::grid_t y() const { return m_y; }
@@ -52,70 +64,105 @@ public:
     void ymax(primitives::space_t c) { m_ymax = c; }
 
     void insert(primitives::point_id_t i);
-    // Returns the node that encompasses the circle with center x, y and radius min_radius.
+    // Returns the node that encompasses the circle with center x, y and a radius of Metric::radius(min_radius),
+    //  or the root for non-planar metrics.
+    template <typename Metric>
     const Node* expand(primitives::space_t x, primitives::space_t y
-        , primitives::space_t min_radius) const;
+        , primitives::space_t min_radius, const SegmentState&) const;
+    template <typename Metric>
     const Node* expand_simple(primitives::space_t x, primitives::space_t y
-        , primitives::space_t min_radius) const;
-
-    primitives::length_t max_segment_length() const { return m_max_segment_length; }
-
-    void remove_segment(std::vector<primitives::quadrant_t>::const_iterator next_quadrant
-        , const std::vector<primitives::quadrant_t>::const_iterator quadrant_end
-        , primitives::length_t length);
-    void add_segment(std::vector<primitives::quadrant_t>::const_iterator next_quadrant
-        , std::vector<primitives::quadrant_t>::const_iterator quadrant_end
-        , primitives::length_t length);
-    void add_segment(const Segment& s, const std::vector<primitives::morton_key_t>& morton_keys);
-
+        , primitives::space_t min_radius, const SegmentState&) const;
+
+    primitives::length_t max_segment_length(const SegmentState& state) const { return state.max_segment_length(m_index); }
+
+    // depth is the depth of this node in the tree.
+    // Returns true if the max segment length of this node changed.
+    bool remove_segment(const morton_keys::SegmentPath&
+        , primitives::length_t length
+        , SegmentState&
+        , primitives::depth_t depth = 0) const;
+    void add_segment(const morton_keys::SegmentPath&
+        , primitives::length_t length
+        , SegmentState&
+        , primitives::depth_t depth = 0) const;
+    void add_segment(const Segment& s, const std::vector<primitives::morton_key_t>& morton_keys
+        , SegmentState&) const;
+
+    // Returns the best improving move of point i to a point under this node.
+    // Children are searched nearest first, and children too far from i to hold a better move are skipped.
+    template <typename Metric>
     VMove search(primitives::point_id_t i
         , const std::vector<primitives::point_id_t>& next
         , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
-        , const DistanceCalculator&
+        , const DistanceCalculator<Metric>&
         , const std::vector<primitives::length_t>& next_lengths
-        , primitives::length_t old_segments_length) const;
+        , primitives::length_t old_segments_length
+        , const SegmentState&) const;
+    template <typename Metric>
     VMove search(primitives::point_id_t i
         , const std::vector<primitives::point_id_t>& next
         , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
-        , const DistanceCalculator&
+        , const DistanceCalculator<Metric>&
         , const std::vector<primitives::length_t>& next_lengths
         , primitives::length_t old_segments_length
+        , const SegmentState&
         , const Segment& permanent_segment) const;
 
+    template <typename Metric>
     void search_perturbation(const primitives::point_id_t i
         , const std::vector<primitives::point_id_t>& next
         , const std::vector<primitives::length_t>& next_lengths
-        , const DistanceCalculator& dc
+        , const DistanceCalculator<Metric>& dc
         , const primitives::length_t min_adjacent_length
         , const primitives::length_t new_adjacent_length
-        , std::vector<VMove>& perturbations) const;
+        , TopMoves& perturbations) const;
+    template <typename Metric>
     void search_perturbation_lax(const primitives::point_id_t i
         , const std::vector<primitives::point_id_t>& next
         , const std::vector<primitives::length_t>& next_lengths
-        , const DistanceCalculator& dc
+        , const DistanceCalculator<Metric>& dc
         , const primitives::length_t max_adjacent_length
         , const primitives::length_t new_adjacent_length
-        , std::vector<VMove>& perturbations) const;
+        , TopMoves& perturbations) const;
+    template <typename Metric>
     void search_perturbation_lateral(const primitives::point_id_t i
         , const std::vector<primitives::point_id_t>& next
         , const std::vector<primitives::length_t>& next_lengths
-        , const DistanceCalculator& dc
+        , const DistanceCalculator<Metric>& dc
         , const primitives::length_t max_adjacent_length
         , const primitives::length_t new_adjacent_length
-        , std::vector<VMove>& perturbations) const;
+        , TopMoves& perturbations) const;
+
+    // Pushes the points of subset under this node, other than i, to nearest_points.
+    template <typename Metric>
+    void nearest(primitives::point_id_t i, const DistanceCalculator<Metric>&
+        , const PointSubset<Metric>&, NearestPoints& nearest_points) const;
+
+    // squared distance from x, y to the bounding box; 0 if inside.
+    primitives::space_t distance_squared(primitives::space_t x, primitives::space_t y) const;
 
 private:
+    // outside_length: max length of segments from points under this node to points outside of it.
+    template <typename Metric>
+    void search(primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+        , const DistanceCalculator<Metric>&
+        , const std::vector<primitives::length_t>& next_lengths
+        , primitives::length_t old_segments_length
+        , primitives::length_t new_adjacent_length
+        , const SegmentState&
+        , const Segment& permanent_segment
+        , primitives::length_t outside_length
+        , VMove& move) const;
+
     Node* m_parent{nullptr};
     ChildArray m_children; // index corresponds to Morton order quadrant.
-
-    // max segment length in this node and children nodes.
-    primitives::length_t m_max_segment_length {0};
+    primitives::node_id_t m_index {0}; // index into SegmentState.
 
     // points immediately under this node (not under children).
     std::vector<primitives::point_id_t> m_points;
 
-    std::vector<primitives::length_t> m_segment_lengths;
-
     primitives::grid_t m_x{0};
     primitives::grid_t m_y{0};
 
@@ -0,0 +1,72 @@
+#pragma once
+
+// Subset of points for nearest point queries, with the number of subset points under every node.
+// Queries skip nodes without subset points, so points can be taken out of the subset as they are used up.
+
+#include "Quadtree.h"
+#include <primitives.h>
+
+#include <cstdint> // uint8_t
+#include <vector>
+
+namespace point_quadtree {
+
+template <typename Metric>
+class PointSubset
+{
+public:
+    // Starts with all points if full, otherwise with none.
+    PointSubset(const Quadtree<Metric>& quadtree, primitives::point_id_t point_count, bool full)
+        : m_quadtree(quadtree)
+        , m_contains(point_count, 0)
+        , m_counts(quadtree.size(), 0)
+    {
+        if (full)
+        {
+            for (primitives::point_id_t i {0}; i < point_count; ++i)
+            {
+                insert(i);
+            }
+        }
+    }
+
+    primitives::point_id_t size() const { return m_size; }
+    bool contains(primitives::point_id_t i) const { return m_contains[i]; }
+    // number of subset points under node.
+    primitives::point_id_t count(primitives::node_id_t node) const { return m_counts[node]; }
+
+    void insert(primitives::point_id_t i)
+    {
+        if (m_contains[i])
+        {
+            return;
+        }
+        m_contains[i] = 1;
+        ++m_size;
+        for (auto node {m_quadtree.leaf(i)}; node != Quadtree<Metric>::no_node; node = m_quadtree.parent(node))
+        {
+            ++m_counts[node];
+        }
+    }
+    void erase(primitives::point_id_t i)
+    {
+        if (not m_contains[i])
+        {
+            return;
+        }
+        m_contains[i] = 0;
+        --m_size;
+        for (auto node {m_quadtree.leaf(i)}; node != Quadtree<Metric>::no_node; node = m_quadtree.parent(node))
+        {
+            --m_counts[node];
+        }
+    }
+
+private:
+    const Quadtree<Metric>& m_quadtree;
+    primitives::point_id_t m_size {0};
+    std::vector<uint8_t> m_contains; // index corresponds to point id.
+    std::vector<primitives::point_id_t> m_counts; // index corresponds to node index.
+};
+
+} // namespace point_quadtree
@@ -0,0 +1,124 @@
+#pragma once
+
+// Quadtree engine built from linked Node objects.
+// Every level has its own Node, so chains of single-child nodes are not collapsed as in LinearQuadtree;
+//  Node addresses segments and expands level by level.
+
+#include "Domain.h"
+#include "Node.h"
+#include "Quadtree.h"
+#include "morton_keys.h"
+#include "point_quadtree.h"
+
+#include <vector>
+
+namespace point_quadtree {
+
+template <typename Metric>
+class PointerQuadtree : public Quadtree<Metric>
+{
+public:
+    PointerQuadtree(const std::vector<primitives::morton_key_t>& morton_keys, const Domain& domain
+        , size_t leaf_capacity, ThreadPool& thread_pool)
+        : m_morton_keys(morton_keys)
+        , m_root(nullptr, domain, 0, 0, 0, 0)
+        , m_leaf_nodes(bulk_initialize_points(m_root, morton_keys, domain, leaf_capacity, thread_pool))
+        , m_nodes(m_root.size(), nullptr)
+    {
+        index_nodes(&m_root);
+    }
+
+    const Node& root() const { return m_root; }
+
+    size_t size() const override { return m_nodes.size(); }
+    primitives::node_id_t leaf(primitives::point_id_t i) const override { return m_leaf_nodes[i]->index(); }
+    primitives::node_id_t parent(primitives::node_id_t node) const override
+    {
+        const auto parent {m_nodes[node]->parent()};
+        return parent ? parent->index() : Quadtree<Metric>::no_node;
+    }
+
+    void nearest(primitives::point_id_t i, const DistanceCalculator<Metric>& dc
+        , const PointSubset<Metric>& subset, NearestPoints& nearest_points) const override
+    {
+        m_root.nearest(i, dc, subset, nearest_points);
+    }
+
+    primitives::node_id_t expand(primitives::node_id_t node
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t old_segments_length, const SegmentState& state) const override
+    {
+        return m_nodes[node]->expand<Metric>(x, y, old_segments_length, state)->index();
+    }
+    primitives::node_id_t expand_simple(primitives::node_id_t node
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t min_radius, const SegmentState& state) const override
+    {
+        return m_nodes[node]->expand_simple<Metric>(x, y, min_radius, state)->index();
+    }
+
+    VMove search(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+        , const DistanceCalculator<Metric>& dc
+        , const std::vector<primitives::length_t>& next_lengths
+        , primitives::length_t old_segments_length
+        , const SegmentState& state
+        , const Segment& permanent_segment) const override
+    {
+        return m_nodes[node]->search(i, next, adjacents, dc, next_lengths, old_segments_length, state, permanent_segment);
+    }
+
+    void search_perturbation(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<primitives::length_t>& next_lengths
+        , const DistanceCalculator<Metric>& dc
+        , primitives::length_t min_adjacent_length
+        , primitives::length_t new_adjacent_length
+        , TopMoves& perturbations) const override
+    {
+        m_nodes[node]->search_perturbation(i, next, next_lengths, dc, min_adjacent_length, new_adjacent_length, perturbations);
+    }
+    void search_perturbation_lax(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<primitives::length_t>& next_lengths
+        , const DistanceCalculator<Metric>& dc
+        , primitives::length_t max_adjacent_length
+        , primitives::length_t new_adjacent_length
+        , TopMoves& perturbations) const override
+    {
+        m_nodes[node]->search_perturbation_lax(i, next, next_lengths, dc, max_adjacent_length, new_adjacent_length, perturbations);
+    }
+
+    void add_segment(const Segment& s, SegmentState& state) const override
+    {
+        m_root.add_segment(morton_keys::segment_insertion_path(m_morton_keys[s.min], m_morton_keys[s.max]), s.length, state);
+    }
+    void remove_segment(const Segment& s, SegmentState& state) const override
+    {
+        m_root.remove_segment(morton_keys::segment_insertion_path(m_morton_keys[s.min], m_morton_keys[s.max]), s.length, state);
+    }
+
+private:
+    const std::vector<primitives::morton_key_t>& m_morton_keys;
+    Node m_root;
+    std::vector<const Node*> m_leaf_nodes; // index corresponds to point id.
+    std::vector<const Node*> m_nodes; // index corresponds to node index.
+
+    void index_nodes(const Node* node)
+    {
+        m_nodes[node->index()] = node;
+        for (const auto& unique_ptr : node->children())
+        {
+            if (unique_ptr)
+            {
+                index_nodes(unique_ptr.get());
+            }
+        }
+    }
+};
+
+} // namespace point_quadtree
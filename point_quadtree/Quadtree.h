@@ -0,0 +1,91 @@
+#pragma once
+
+// Interface of the quadtree engines used by the solver.
+// Nodes are referred to by index, which is also their index into a SegmentState.
+// Points are held by leaves (see point_quadtree::is_leaf), and a segment is held by
+//  the deepest node above both of its endpoints (see morton_keys::segment_insertion_path),
+//  or by the leaf holding both.
+// Lengths follow the edge weight type Metric (see metric.h); search and expand relate them to
+//  coordinate distances with Metric::radius, or give up pruning for non-planar metrics.
+
+#include "NearestPoints.h"
+#include "SegmentState.h"
+#include "TopMoves.h"
+#include "VMove.h"
+#include <DistanceCalculator.h>
+#include <Segment.h>
+#include <primitives.h>
+
+#include <array>
+#include <limits> // numeric_limits
+#include <vector>
+
+namespace point_quadtree {
+
+template <typename Metric>
+class PointSubset;
+
+template <typename Metric>
+class Quadtree
+{
+public:
+    static constexpr primitives::node_id_t no_node {std::numeric_limits<primitives::node_id_t>::max()};
+
+    virtual ~Quadtree() = default;
+
+    // number of nodes.
+    virtual size_t size() const = 0;
+    // node holding point i.
+    virtual primitives::node_id_t leaf(primitives::point_id_t i) const = 0;
+    // no_node for the root.
+    virtual primitives::node_id_t parent(primitives::node_id_t node) const = 0;
+
+    // Pushes the points of subset other than i to nearest, skipping nodes too far from i to hold
+    //  a point that nearest would keep.
+    // Points are ranked by coordinate distance, which ranks them by length only for planar metrics.
+    virtual void nearest(primitives::point_id_t i, const DistanceCalculator<Metric>&
+        , const PointSubset<Metric>&, NearestPoints& nearest) const = 0;
+
+    // Returns the first ancestor of node (inclusive) that encompasses the circle with center x, y
+    //  and a radius of old_segments_length plus the max segment length of every node on the way.
+    virtual primitives::node_id_t expand(primitives::node_id_t node
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t old_segments_length, const SegmentState&) const = 0;
+    virtual primitives::node_id_t expand_simple(primitives::node_id_t node
+        , primitives::space_t x, primitives::space_t y
+        , primitives::space_t min_radius, const SegmentState&) const = 0;
+
+    // Returns the best improving move of point i to a point under node.
+    // permanent_segment is not removed by the move, if it has nonzero length.
+    virtual VMove search(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+        , const DistanceCalculator<Metric>&
+        , const std::vector<primitives::length_t>& next_lengths
+        , primitives::length_t old_segments_length
+        , const SegmentState&
+        , const Segment& permanent_segment) const = 0;
+
+    virtual void search_perturbation(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<primitives::length_t>& next_lengths
+        , const DistanceCalculator<Metric>&
+        , primitives::length_t min_adjacent_length
+        , primitives::length_t new_adjacent_length
+        , TopMoves& perturbations) const = 0;
+    virtual void search_perturbation_lax(primitives::node_id_t node
+        , primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& next
+        , const std::vector<primitives::length_t>& next_lengths
+        , const DistanceCalculator<Metric>&
+        , primitives::length_t max_adjacent_length
+        , primitives::length_t new_adjacent_length
+        , TopMoves& perturbations) const = 0;
+
+    virtual void add_segment(const Segment&, SegmentState&) const = 0;
+    virtual void remove_segment(const Segment&, SegmentState&) const = 0;
+};
+
+} // namespace point_quadtree
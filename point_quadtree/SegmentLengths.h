@@ -0,0 +1,55 @@
+#pragma once
+
+// Multiset of segment lengths held by a quadtree node, supporting insert, remove and max in O(log k).
+// Each distinct length is kept with its count, so removing a length that was never inserted is detected.
+
+#include <primitives.h>
+
+#include <cstddef> // size_t
+#include <cstdlib> // abort
+#include <iostream>
+#include <map>
+
+namespace point_quadtree {
+
+class SegmentLengths
+{
+public:
+    bool empty() const { return m_counts.empty(); }
+    size_t size() const { return m_size; }
+
+    primitives::length_t max() const { return m_counts.empty() ? 0 : m_counts.rbegin()->first; }
+
+    void insert(primitives::length_t length)
+    {
+        ++m_counts[length];
+        ++m_size;
+    }
+
+    void remove(primitives::length_t length)
+    {
+        const auto it {m_counts.find(length)};
+        if (it == std::end(m_counts))
+        {
+            std::cout << __func__ << ": error: tried to erase a length that does not exist." << std::endl;
+            std::abort();
+        }
+        if (--it->second == 0)
+        {
+            m_counts.erase(it);
+        }
+        --m_size;
+    }
+
+    void clear()
+    {
+        m_counts.clear();
+        m_size = 0;
+    }
+
+private:
+    std::map<primitives::length_t, size_t> m_counts; // count of every distinct length.
+    size_t m_size {0};
+};
+
+} // namespace point_quadtree
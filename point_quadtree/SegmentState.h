@@ -0,0 +1,44 @@
+#pragma once
+
+// Segment lengths held by quadtree nodes, indexed by Node::index().
+// This is kept apart from Node so that the point structure of a tree can be shared
+//  while every solver worker modifies its own copy of the segment state.
+
+#include "SegmentLengths.h"
+#include <primitives.h>
+
+#include <algorithm> // fill
+#include <vector>
+
+namespace point_quadtree {
+
+class SegmentState
+{
+public:
+    SegmentState(size_t node_count)
+        : m_segment_lengths(node_count)
+        , m_max_segment_length(node_count, 0) {}
+
+    void reset()
+    {
+        for (auto& lengths : m_segment_lengths)
+        {
+            lengths.clear();
+        }
+        std::fill(std::begin(m_max_segment_length), std::end(m_max_segment_length), 0);
+    }
+
+    // segments whose endpoints are both under the node, but not both under the same child.
+    SegmentLengths& segment_lengths(primitives::node_id_t node) { return m_segment_lengths[node]; }
+    const SegmentLengths& segment_lengths(primitives::node_id_t node) const { return m_segment_lengths[node]; }
+
+    // max segment length in the node and children nodes.
+    primitives::length_t max_segment_length(primitives::node_id_t node) const { return m_max_segment_length[node]; }
+    void max_segment_length(primitives::node_id_t node, primitives::length_t length) { m_max_segment_length[node] = length; }
+
+private:
+    std::vector<SegmentLengths> m_segment_lengths;
+    std::vector<primitives::length_t> m_max_segment_length;
+};
+
+} // namespace point_quadtree
@@ -0,0 +1,67 @@
+#pragma once
+
+// Hilbert keys are positions along the Hilbert curve through the same grid as Morton keys.
+// Unlike the Morton curve, consecutive cells along the curve always share an edge,
+//  so sorting points by Hilbert key keeps spatial neighbours close in memory and in a tour.
+// Hilbert keys have the same range as Morton keys, so radix_sort applies unchanged;
+//  the quadtree itself is always indexed by Morton keys.
+
+#include "Domain.h"
+#include "morton_keys.h"
+#include <ThreadPool.h>
+#include <constants.h>
+#include <primitives.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace point_quadtree {
+namespace hilbert_keys {
+
+// Hilbert key of the grid cell with the given Morton key.
+// The Morton key holds the quadrant of the cell at every level, from the top. The Hilbert digit of a quadrant
+//  depends on the orientation of the curve in the parent cell, which is one of four states.
+inline primitives::morton_key_t hilbert_key(primitives::morton_key_t morton_key)
+{
+    // indexed by 4 * state + Morton quadrant; entries are 4 * next state + Hilbert digit.
+    constexpr uint8_t transitions[16] {4, 1, 11, 2, 0, 15, 5, 6, 10, 9, 3, 12, 14, 7, 13, 8};
+    primitives::morton_key_t key {0};
+    uint8_t state {0};
+    for (int level {constants::max_tree_depth - 1}; level >= 0; --level)
+    {
+        const auto entry {transitions[4 * state + ((morton_key >> (2 * level)) & 3)]};
+        key = (key << 2) | (entry & 3);
+        state = entry >> 2;
+    }
+    return key;
+}
+
+inline primitives::morton_key_t hilbert_key(double normalized_coordinate1, double normalized_coordinate2)
+{
+    return hilbert_key(morton_keys::interleave_coordinates(normalized_coordinate1, normalized_coordinate2));
+}
+
+inline std::vector<primitives::morton_key_t> compute_point_hilbert_keys(const std::vector<primitives::coordinate_t>& x, const std::vector<primitives::coordinate_t>& y,
+    const Domain& domain, ThreadPool& thread_pool)
+{
+    return morton_keys::compute_point_keys(x, y, domain, thread_pool
+        , [](double x_normalized, double y_normalized) { return hilbert_key(x_normalized, y_normalized); });
+}
+
+// Hilbert keys of points whose Morton keys are already computed.
+inline std::vector<primitives::morton_key_t> compute_point_hilbert_keys(const std::vector<primitives::morton_key_t>& morton_keys
+    , ThreadPool& thread_pool)
+{
+    std::vector<primitives::morton_key_t> point_keys(morton_keys.size());
+    thread_pool.for_each_chunk(morton_keys.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t i {begin}; i < end; ++i)
+        {
+            point_keys[i] = hilbert_key(morton_keys[i]);
+        }
+    });
+    return point_keys;
+}
+
+} // namespace hilbert_keys
+} // namespace point_quadtree
@@ -3,17 +3,38 @@
 // Morton keys are interleaved coordinates, which are integer reprentations of x, y coordinates normalized to [0, 1].
 
 #include "Domain.h"
+#include <ThreadPool.h>
 #include <constants.h>
 #include <primitives.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <iostream>
 #include <vector>
+#ifdef __BMI2__
+#include <immintrin.h> // _pdep_u64
+#endif
 
 namespace point_quadtree {
 namespace morton_keys {
 
+// Spreads the bits of c so that bit i moves to bit 2 * i.
+inline primitives::morton_key_t spread_bits(uint32_t c)
+{
+#ifdef __BMI2__
+    return _pdep_u64(c, 0x5555555555555555);
+#else
+    primitives::morton_key_t spread {c};
+    spread = (spread | (spread << 16)) & 0x0000ffff0000ffff;
+    spread = (spread | (spread << 8)) & 0x00ff00ff00ff00ff;
+    spread = (spread | (spread << 4)) & 0x0f0f0f0f0f0f0f0f;
+    spread = (spread | (spread << 2)) & 0x3333333333333333;
+    spread = (spread | (spread << 1)) & 0x5555555555555555;
+    return spread;
+#endif
+}
+
 inline primitives::morton_key_t interleave_coordinates(double normalized_coordinate1, double normalized_coordinate2)
 {
     // if c1 and c2 are x and y respectively, then the curve looks like an "N" in "typical" coordinate space (+y is up, +x is right).
@@ -21,48 +42,69 @@ inline primitives::morton_key_t interleave_coordinates(double normalized_coordin
     constexpr IntegerCoordinate IntegerCoordinateMax {static_cast<IntegerCoordinate>(1) << (constants::max_tree_depth - 1)}; // to be multiplied by the normalized (0,1) coordinate.
     IntegerCoordinate c1 {static_cast<IntegerCoordinate>(IntegerCoordinateMax * normalized_coordinate1)};
     IntegerCoordinate c2 {static_cast<IntegerCoordinate>(IntegerCoordinateMax * normalized_coordinate2)};
-    primitives::morton_key_t morton_key {static_cast<primitives::morton_key_t>(0)};
-    constexpr int bytes {sizeof(IntegerCoordinate)};
-    constexpr int bits {8 * bytes};
-    for (int i {bits - 1}; i >= 0; --i)
-    {
-        constexpr primitives::morton_key_t last_bit_mask {static_cast<primitives::morton_key_t>(1)};
-        morton_key |= (c1 >> i) & last_bit_mask;
-        morton_key <<= 1;
-        morton_key |= (c2 >> i) & last_bit_mask;
-        if (i != 0)
-        {
-            morton_key <<= 1;
-        }
-    }
-    return morton_key;
+    return (spread_bits(c1) << 1) | spread_bits(c2);
+}
+
+inline void out_of_bounds(const char* function, const char* axis, double normalized_coordinate)
+{
+    std::cout << function << ": error: out-of-bounds normalized " << axis << " coordinate: "
+        << normalized_coordinate << std::endl;
+    std::abort();
 }
 
-inline std::vector<primitives::morton_key_t> compute_point_morton_keys(const std::vector<double>& x, const std::vector<double>& y,
-    const Domain& domain)
+// Computes key(x_normalized, y_normalized) for every point, with coordinates normalized to [0, 1] by domain.
+// Keys are computed in parallel chunks; the loop over a chunk is branch-free so that it vectorizes.
+template <typename KeyFunction>
+std::vector<primitives::morton_key_t> compute_point_keys(const std::vector<primitives::coordinate_t>& x, const std::vector<primitives::coordinate_t>& y
+    , const Domain& domain, ThreadPool& thread_pool, const KeyFunction& key)
 {
     const size_t point_count {x.size()};
-    std::vector<primitives::morton_key_t> point_morton_keys;
+    std::vector<primitives::morton_key_t> point_keys(point_count);
+    const auto xmin {domain.xmin()};
+    const auto ymin {domain.ymin()};
+    const auto xdim {domain.xdim(0)};
+    const auto ydim {domain.ydim(0)};
+    std::atomic<bool> out_of_bounds_found {false};
+    thread_pool.for_each_chunk(point_count, [&](size_t begin, size_t end, size_t)
+    {
+        bool outside {false};
+        for (size_t i {begin}; i < end; ++i)
+        {
+            const double x_normalized {(primitives::to_space(x[i]) - xmin) / xdim};
+            const double y_normalized {(primitives::to_space(y[i]) - ymin) / ydim};
+            outside |= (x_normalized < 0.0) | (x_normalized > 1.0) | (y_normalized < 0.0) | (y_normalized > 1.0);
+            point_keys[i] = key(x_normalized, y_normalized);
+        }
+        if (outside)
+        {
+            out_of_bounds_found = true;
+        }
+    });
+    if (not out_of_bounds_found)
+    {
+        return point_keys;
+    }
+    // find the first offending point for the error message.
     for (size_t i {0}; i < point_count; ++i)
     {
-        double x_normalized {(x[i] - domain.xmin()) / domain.xdim(0)};
-        double y_normalized {(y[i] - domain.ymin()) / domain.ydim(0)};
+        const double x_normalized {(primitives::to_space(x[i]) - xmin) / xdim};
+        const double y_normalized {(primitives::to_space(y[i]) - ymin) / ydim};
         if (x_normalized < 0.0 or x_normalized > 1.0)
         {
-            std::cout << __func__ << ": error: out-of-bounds normalized x coordinate: "
-                << x_normalized << std::endl;
-            std::abort();
+            out_of_bounds(__func__, "x", x_normalized);
         }
         if (y_normalized < 0.0 or y_normalized > 1.0)
         {
-            std::cout << __func__ << ": error: out-of-bounds normalized y coordinate: "
-                << y_normalized << std::endl;
-            std::abort();
+            out_of_bounds(__func__, "y", y_normalized);
         }
-        primitives::morton_key_t morton_key {interleave_coordinates(x_normalized, y_normalized)};
-        point_morton_keys.push_back(morton_key);
     }
-    return point_morton_keys;
+    return point_keys;
+}
+
+inline std::vector<primitives::morton_key_t> compute_point_morton_keys(const std::vector<primitives::coordinate_t>& x, const std::vector<primitives::coordinate_t>& y,
+    const Domain& domain, ThreadPool& thread_pool)
+{
+    return compute_point_keys(x, y, domain, thread_pool, interleave_coordinates);
 }
 
 inline std::array<primitives::quadrant_t, constants::max_tree_depth - 1> point_insertion_path(primitives::morton_key_t key)
@@ -79,32 +121,36 @@ inline std::array<primitives::quadrant_t, constants::max_tree_depth - 1> point_i
     return path;
 }
 
-inline std::vector<primitives::quadrant_t> segment_insertion_path(primitives::morton_key_t key1, primitives::morton_key_t key2)
+// quadrant of the child at depth + 1 above key, of the node at depth above key.
+inline primitives::quadrant_t quadrant(primitives::morton_key_t key, primitives::depth_t depth)
 {
-    constexpr primitives::morton_key_t MORTON_THREE
-        = static_cast<primitives::morton_key_t>(3); // quadrant mask.
-    std::vector<primitives::quadrant_t> path;
-    // We skip i = 0 because that corresponds to the root node,
-    //  for which no bits are reserved.
-    for(int i = 1; i < constants::max_tree_depth; ++i)
+    constexpr primitives::morton_key_t quadrant_mask {static_cast<primitives::morton_key_t>(3)}; // binary: 11
+    const auto shift_bits {2 * (constants::max_tree_depth - 2 - depth)};
+    return static_cast<primitives::quadrant_t>((key >> shift_bits) & quadrant_mask);
+}
+
+// Path from the root to the node holding a segment, which is the deepest node above both endpoints.
+// The path is read off the key of either endpoint, so it needs no storage.
+struct SegmentPath
+{
+    primitives::morton_key_t key {0};
+    primitives::depth_t depth {0}; // of the node holding the segment; the root has depth 0.
+
+    // quadrant of the child at depth + 1 of the path node at depth.
+    primitives::quadrant_t quadrant(primitives::depth_t depth) const { return morton_keys::quadrant(key, depth); }
+};
+
+inline SegmentPath segment_insertion_path(primitives::morton_key_t key1, primitives::morton_key_t key2)
+{
+    // Keys share the node at depth d if they agree on all bits from 2 * (max_tree_depth - 1 - d) up.
+    constexpr primitives::depth_t max_depth {constants::max_tree_depth - 1};
+    const auto different_bits {key1 ^ key2};
+    if (different_bits == 0)
     {
-        constexpr int max_quadrants {constants::max_tree_depth - 1};
-        const int quadrant_shift {max_quadrants - i};
-        const int bit_shift {2 * quadrant_shift};
-        primitives::morton_key_t level1 = key1 >> bit_shift;
-        primitives::morton_key_t level2 = key2 >> bit_shift;
-        if (level1 == level2)
-        {
-            primitives::quadrant_t quadrant
-                = static_cast<primitives::quadrant_t>(level1 & MORTON_THREE);
-            path.push_back(quadrant);
-        }
-        else
-        {
-            break;
-        }
+        return {key1, max_depth};
     }
-    return path;
+    const primitives::depth_t highest_bit {63 - __builtin_clzll(different_bits)};
+    return {key1, std::max(max_depth - 1 - highest_bit / 2, 0)};
 }
 
 } // namespace morton_keys
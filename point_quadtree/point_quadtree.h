@@ -2,9 +2,13 @@
 
 #include "Node.h"
 #include "morton_keys.h"
+#include "radix_sort.h"
+#include <ThreadPool.h>
 #include <check.h>
 #include <primitives.h>
 
+#include <vector>
+
 namespace point_quadtree {
 
 inline primitives::grid_t quadrant_x(primitives::quadrant_t q)
@@ -45,10 +49,12 @@ inline primitives::grid_t quadrant_y(primitives::quadrant_t q)
     }
 }
 
+// node_count is used as the index of new nodes and incremented.
 inline const Node* insert_point(const std::vector<primitives::morton_key_t>& morton_keys
     , primitives::point_id_t point_id
     , Node* root
-    , const Domain& domain)
+    , const Domain& domain
+    , primitives::node_id_t& node_count)
 {
     auto point_destination {root};
     primitives::depth_t depth {0};
@@ -64,7 +70,7 @@ inline const Node* insert_point(const std::vector<primitives::morton_key_t>& mor
         auto child = point_destination->child(quadrant);
         if (not child)
         {
-            point_destination->create_child(quadrant, domain, x, y, depth);
+            point_destination->create_child(quadrant, domain, x, y, depth, node_count++);
             child = point_destination->child(quadrant);
         }
         point_destination = child;
@@ -78,14 +84,148 @@ inline std::vector<const point_quadtree::Node*> initialize_points(point_quadtree
     , const point_quadtree::Domain& domain)
 {
     std::vector<const point_quadtree::Node*> leaf_nodes(morton_keys.size(), nullptr);
+    auto node_count {static_cast<primitives::node_id_t>(root.size())};
     for (primitives::point_id_t i {0}; i < morton_keys.size(); ++i)
     {
-        const auto node {point_quadtree::insert_point(morton_keys, i, &root, domain)};
+        const auto node {point_quadtree::insert_point(morton_keys, i, &root, domain, node_count)};
         leaf_nodes[i] = node;
     }
     check::all_true(leaf_nodes, "node assignments to every point");
     return leaf_nodes;
 }
 
+// Nodes hold up to leaf_capacity points without children, except at the maximum depth.
+inline bool is_leaf(primitives::depth_t depth, size_t point_count, size_t leaf_capacity)
+{
+    return depth == constants::max_tree_depth - 1 or point_count <= leaf_capacity;
+}
+
+// Returns the end of the run of Morton-sorted points from begin that share the child quadrant of the node at depth.
+inline size_t quadrant_end(const std::vector<primitives::point_id_t>& sorted_points
+    , const std::vector<primitives::morton_key_t>& morton_keys
+    , primitives::depth_t depth, size_t begin, size_t end)
+{
+    const auto quadrant {morton_keys::quadrant(morton_keys[sorted_points[begin]], depth)};
+    auto run_end {begin + 1};
+    while (run_end < end and morton_keys::quadrant(morton_keys[sorted_points[run_end]], depth) == quadrant)
+    {
+        ++run_end;
+    }
+    return run_end;
+}
+
+// Number of nodes below a node at depth, for the Morton-sorted points in [begin, end) under it.
+inline size_t count_descendants(const std::vector<primitives::point_id_t>& sorted_points
+    , const std::vector<primitives::morton_key_t>& morton_keys
+    , primitives::depth_t depth, size_t begin, size_t end
+    , size_t leaf_capacity)
+{
+    if (is_leaf(depth, end - begin, leaf_capacity))
+    {
+        return 0;
+    }
+    size_t count {0};
+    for (auto child_begin {begin}; child_begin < end; )
+    {
+        const auto child_end {quadrant_end(sorted_points, morton_keys, depth, child_begin, end)};
+        count += 1 + count_descendants(sorted_points, morton_keys, depth + 1, child_begin, child_end, leaf_capacity);
+        child_begin = child_end;
+    }
+    return count;
+}
+
+// Subtree whose node exists, but whose descendants are yet to be created.
+struct BuildTask
+{
+    Node* node {nullptr};
+    primitives::depth_t depth {0};
+    size_t begin {0}; // range of Morton-sorted points.
+    size_t end {0};
+};
+
+// Creates the descendants of node from the Morton-sorted points in [begin, end), depth first.
+// If tasks is given, nodes at depth task_depth are not expanded, but appended to tasks instead.
+inline void build_subtree(const BuildTask& task
+    , const std::vector<primitives::point_id_t>& sorted_points
+    , const std::vector<primitives::morton_key_t>& morton_keys
+    , const Domain& domain
+    , size_t leaf_capacity
+    , primitives::node_id_t& node_count
+    , std::vector<const Node*>& leaf_nodes
+    , primitives::depth_t task_depth = constants::max_tree_depth
+    , std::vector<BuildTask>* tasks = nullptr)
+{
+    if (is_leaf(task.depth, task.end - task.begin, leaf_capacity))
+    {
+        for (auto p {task.begin}; p < task.end; ++p)
+        {
+            task.node->insert(sorted_points[p]);
+            leaf_nodes[sorted_points[p]] = task.node;
+        }
+        return;
+    }
+    if (tasks and task.depth == task_depth)
+    {
+        tasks->push_back(task);
+        return;
+    }
+    for (auto child_begin {task.begin}; child_begin < task.end; )
+    {
+        const auto child_end {quadrant_end(sorted_points, morton_keys, task.depth, child_begin, task.end)};
+        const auto quadrant {morton_keys::quadrant(morton_keys[sorted_points[child_begin]], task.depth)};
+        const auto x {(task.node->x() << 1) + quadrant_x(quadrant)};
+        const auto y {(task.node->y() << 1) + quadrant_y(quadrant)};
+        task.node->create_child(quadrant, domain, x, y, task.depth + 1, node_count++);
+        build_subtree({task.node->child(quadrant), task.depth + 1, child_begin, child_end}
+            , sorted_points, morton_keys, domain, leaf_capacity, node_count, leaf_nodes, task_depth, tasks);
+        child_begin = child_end;
+    }
+}
+
+// Builds a tree from points sorted by Morton key, in which nodes with up to leaf_capacity points are leaves.
+// With a leaf_capacity of 0, this is the same tree as initialize_points builds.
+// The tree is built top-down over the sorted runs and keeps chains of single-child nodes;
+//  only LinearQuadtree collapses them.
+// The top levels are built serially; the subtrees below them are built in parallel,
+//  with node indices offset by the node counts of the subtrees before them.
+inline std::vector<const point_quadtree::Node*> bulk_initialize_points(point_quadtree::Node& root
+    , const std::vector<primitives::morton_key_t>& morton_keys
+    , const point_quadtree::Domain& domain
+    , size_t leaf_capacity
+    , ThreadPool& thread_pool)
+{
+    constexpr primitives::depth_t task_depth {3}; // up to 64 subtrees.
+    const auto sorted_points {sort_by_morton_key(morton_keys, thread_pool)};
+    std::vector<const point_quadtree::Node*> leaf_nodes(morton_keys.size(), nullptr);
+    auto node_count {static_cast<primitives::node_id_t>(root.size())};
+    std::vector<BuildTask> tasks;
+    build_subtree({&root, 0, 0, sorted_points.size()}, sorted_points, morton_keys, domain
+        , leaf_capacity, node_count, leaf_nodes, task_depth, &tasks);
+
+    std::vector<primitives::node_id_t> task_node_counts(tasks.size());
+    thread_pool.for_each_chunk(tasks.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (auto t {begin}; t < end; ++t)
+        {
+            task_node_counts[t] = static_cast<primitives::node_id_t>(
+                count_descendants(sorted_points, morton_keys, tasks[t].depth, tasks[t].begin, tasks[t].end, leaf_capacity));
+        }
+    });
+    thread_pool.for_each_chunk(tasks.size(), [&](size_t begin, size_t end, size_t)
+    {
+        auto task_node_count {node_count};
+        for (size_t t {0}; t < begin; ++t)
+        {
+            task_node_count += task_node_counts[t];
+        }
+        for (auto t {begin}; t < end; ++t)
+        {
+            build_subtree(tasks[t], sorted_points, morton_keys, domain, leaf_capacity, task_node_count, leaf_nodes);
+        }
+    });
+    check::all_true(leaf_nodes, "node assignments to every point");
+    return leaf_nodes;
+}
+
 } // namespace point_quadtree
 
@@ -0,0 +1,67 @@
+#pragma once
+
+// Parallel sorting of points by Morton key.
+
+#include <ThreadPool.h>
+#include <constants.h>
+#include <primitives.h>
+
+#include <algorithm> // fill
+#include <numeric> // iota
+#include <vector>
+
+namespace point_quadtree {
+
+// Returns point ids sorted by Morton key; points with equal keys stay in id order.
+// Least-significant-digit radix sort: each chunk of points is counted and scattered in parallel,
+//  into offsets ordered by digit, then by chunk, so every pass is stable.
+inline std::vector<primitives::point_id_t> sort_by_morton_key(const std::vector<primitives::morton_key_t>& morton_keys
+    , ThreadPool& thread_pool)
+{
+    constexpr int digit_bits {11};
+    constexpr int key_bits {2 * constants::max_tree_depth};
+    constexpr size_t radix {static_cast<size_t>(1) << digit_bits};
+    constexpr primitives::morton_key_t digit_mask {radix - 1};
+
+    const auto point_count {morton_keys.size()};
+    std::vector<primitives::point_id_t> sorted(point_count);
+    std::iota(std::begin(sorted), std::end(sorted), 0);
+    std::vector<primitives::point_id_t> buffer(point_count);
+    const auto chunks {thread_pool.chunk_count(point_count)};
+    std::vector<std::vector<size_t>> offsets(chunks, std::vector<size_t>(radix));
+    for (int shift {0}; shift < key_bits; shift += digit_bits)
+    {
+        thread_pool.for_each_chunk(point_count, [&](size_t begin, size_t end, size_t chunk)
+        {
+            auto& counts {offsets[chunk]};
+            std::fill(std::begin(counts), std::end(counts), 0);
+            for (auto p {begin}; p < end; ++p)
+            {
+                ++counts[(morton_keys[sorted[p]] >> shift) & digit_mask];
+            }
+        });
+        size_t offset {0};
+        for (size_t digit {0}; digit < radix; ++digit)
+        {
+            for (auto& chunk_offsets : offsets)
+            {
+                const auto count {chunk_offsets[digit]};
+                chunk_offsets[digit] = offset;
+                offset += count;
+            }
+        }
+        thread_pool.for_each_chunk(point_count, [&](size_t begin, size_t end, size_t chunk)
+        {
+            auto& chunk_offsets {offsets[chunk]};
+            for (auto p {begin}; p < end; ++p)
+            {
+                const auto point {sorted[p]};
+                buffer[chunk_offsets[(morton_keys[point] >> shift) & digit_mask]++] = point;
+            }
+        });
+        sorted.swap(buffer);
+    }
+    return sorted;
+}
+
+} // namespace point_quadtree
@@ -0,0 +1,157 @@
+#pragma once
+
+// Evaluation of V-moves of point i to a list of candidate points, shared by the leaves of
+//  the quadtree engines and by candidate lists.
+// With AVX2, EUC_2D and double coordinates, candidates are evaluated four at a time: their coordinates and those of
+//  their next points are gathered into lanes, and lengths are rounded as in metric::Euc2d,
+//  so the best move is the same as that of the scalar scan.
+
+#include "VMove.h"
+#include <DistanceCalculator.h>
+#include <Segment.h>
+#include <primitives.h>
+
+#include <type_traits> // is_same_v
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace point_quadtree {
+
+// Applies the best improving move of i to a point in [begin, end) to move.
+// old_segments_length: length of the segments removed at i.
+// new_adjacent_length: length of the segment joining the adjacent points of i.
+template <typename Metric>
+inline void search_points(const primitives::point_id_t* begin, const primitives::point_id_t* end
+    , primitives::point_id_t i
+    , const std::vector<primitives::point_id_t>& next
+    , const DistanceCalculator<Metric>& dc
+    , const std::vector<primitives::length_t>& next_lengths
+    , primitives::length_t old_segments_length
+    , primitives::length_t new_adjacent_length
+    , const Segment& permanent_segment
+    , VMove& move)
+{
+    const bool has_permanent {permanent_segment.length > 0};
+    auto excluded = [&](primitives::point_id_t p)
+    {
+        return p == i or next[p] == i or (has_permanent and permanent_segment.same(p, next[p]));
+    };
+    // true only if d(i, p) > length; without a sqrt for planar metrics.
+    auto exceeds = [&](primitives::point_id_t p, primitives::length_t length)
+    {
+        if constexpr (Metric::planar)
+        {
+            return dc.compute_squared(i, p) > Metric::squared_bound(length);
+        }
+        else
+        {
+            return false;
+        }
+    };
+#ifdef __AVX2__
+    if constexpr (std::is_same_v<Metric, metric::Euc2d> and std::is_same_v<primitives::coordinate_t, double>)
+    {
+        constexpr int lanes {4};
+        const auto* x {dc.x().data()};
+        const auto* y {dc.y().data()};
+        const auto xi {_mm256_set1_pd(dc.x(i))};
+        const auto yi {_mm256_set1_pd(dc.y(i))};
+        const auto ii {_mm_set1_epi32(static_cast<int>(i))};
+        const auto half {_mm256_set1_pd(0.5)};
+        const auto adjacent_length {_mm256_set1_pd(static_cast<double>(new_adjacent_length))};
+        // masked gathers with an explicit source; the unmasked intrinsics trip -Wmaybe-uninitialized.
+        const auto all_lanes {_mm256_castsi256_pd(_mm256_set1_epi64x(-1))};
+        auto gather = [&](const double* coordinates, __m128i points)
+        {
+            return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), coordinates, points, all_lanes, sizeof(double));
+        };
+        auto rounded_length = [&](__m128i points)
+        {
+            const auto dx {_mm256_sub_pd(xi, gather(x, points))};
+            const auto dy {_mm256_sub_pd(yi, gather(y, points))};
+            const auto exact {_mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)))};
+            return _mm256_floor_pd(_mm256_add_pd(exact, half));
+        };
+        for (; end - begin >= lanes; begin += lanes)
+        {
+            const auto points {_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin))};
+            const auto reduction {_mm256_set_pd(
+                static_cast<double>(old_segments_length + next_lengths[begin[3]])
+                , static_cast<double>(old_segments_length + next_lengths[begin[2]])
+                , static_cast<double>(old_segments_length + next_lengths[begin[1]])
+                , static_cast<double>(old_segments_length + next_lengths[begin[0]]))};
+            // as in the scalar scan, next points are only needed for points near enough to i.
+            const auto length {rounded_length(points)};
+            auto near {_mm256_movemask_pd(_mm256_cmp_pd(length, reduction, _CMP_LE_OQ))};
+            if (near == 0)
+            {
+                continue;
+            }
+            const auto next_points {_mm_mask_i32gather_epi32(_mm_setzero_si128()
+                , reinterpret_cast<const int*>(next.data()), points, _mm_set1_epi32(-1), sizeof(int))};
+            near &= ~_mm_movemask_ps(_mm_castsi128_ps(
+                _mm_or_si128(_mm_cmpeq_epi32(points, ii), _mm_cmpeq_epi32(next_points, ii))));
+            for (int lane {0}; has_permanent and lane < lanes; ++lane)
+            {
+                if (permanent_segment.same(begin[lane], next[begin[lane]]))
+                {
+                    near &= ~(1 << lane);
+                }
+            }
+            if (near == 0)
+            {
+                continue;
+            }
+            const auto new_length {_mm256_add_pd(_mm256_add_pd(length, rounded_length(next_points)), adjacent_length)};
+            alignas(32) double improvement[lanes];
+            _mm256_store_pd(improvement, _mm256_sub_pd(reduction, new_length));
+            for (int lane {0}; lane < lanes; ++lane)
+            {
+                if (near & (1 << lane) and improvement[lane] > 0)
+                {
+                    move.apply({i, begin[lane], static_cast<primitives::length_t>(improvement[lane])});
+                }
+            }
+        }
+    }
+#endif
+    for (; begin != end; ++begin)
+    {
+        const auto p {*begin};
+        if (excluded(p))
+        {
+            continue;
+        }
+        const auto reduction {old_segments_length + next_lengths[p]};
+        if (reduction <= new_adjacent_length)
+        {
+            continue;
+        }
+        // an improving move needs d(i, p) + d(i, next[p]) < budget.
+        // most candidates are rejected on squared distances before any sqrt.
+        const auto budget {reduction - new_adjacent_length};
+        if (exceeds(p, budget - 1))
+        {
+            continue;
+        }
+        const auto first_length {dc.compute_length(i, p)};
+        if (first_length >= budget)
+        {
+            continue;
+        }
+        const auto remaining {budget - first_length};
+        if (exceeds(next[p], remaining - 1))
+        {
+            continue;
+        }
+        const auto second_length {dc.compute_length(i, next[p])};
+        if (second_length < remaining)
+        {
+            move.apply({i, p, remaining - second_length});
+        }
+    }
+}
+
+} // namespace point_quadtree
@@ -2,19 +2,61 @@
 
 // Aliases for primitive types.
 
+#include <cmath> // round
 #include <cstdint>
+#include <cstdlib> // abort
+#include <iostream>
 #include <limits>
 
 namespace primitives {
 
 using length_t = uint64_t; // as in Segment lengths.
 using point_id_t = uint32_t;
-using space_t = double; // as in x, y coordinates.
+using space_t = double; // as in computations on x, y coordinates.
+
+// Storage of point coordinates. Reduced precision halves coordinate memory; see --validate.
+#if defined(V_OPT_FLOAT_COORDINATES)
+using coordinate_t = float;
+#elif defined(V_OPT_FIXED_COORDINATES)
+using coordinate_t = int32_t; // in units of 1 / fixed_scale.
+#ifndef V_OPT_FIXED_SCALE
+#define V_OPT_FIXED_SCALE 1
+#endif
+constexpr space_t fixed_scale {V_OPT_FIXED_SCALE};
+#else
+using coordinate_t = double;
+#endif
+
+inline space_t to_space(coordinate_t c)
+{
+#if defined(V_OPT_FIXED_COORDINATES)
+    return c / fixed_scale;
+#else
+    return c;
+#endif
+}
+
+// nearest coordinate.
+inline coordinate_t to_coordinate(space_t s)
+{
+#if defined(V_OPT_FIXED_COORDINATES)
+    const auto scaled {std::round(s * fixed_scale)};
+    if (not (scaled >= std::numeric_limits<coordinate_t>::min() and scaled <= std::numeric_limits<coordinate_t>::max()))
+    {
+        std::cout << __func__ << ": error: coordinate out of fixed-point range: " << s << std::endl;
+        std::abort();
+    }
+    return static_cast<coordinate_t>(scaled);
+#else
+    return static_cast<coordinate_t>(s);
+#endif
+}
 
 using depth_t = int; // as in maximum quadtree depth.
 using quadrant_t = int; // as in quadtree quadrant index.
 using morton_key_t = uint64_t;
 using grid_t = int; // for indexing a grid produced by a quadtree at a certain depth.
+using node_id_t = uint32_t; // quadtree node index.
 
 } // namespace primitives
 
@@ -1,91 +1,208 @@
 #pragma once
 
+#include "Budget.h"
 #include "DistanceCalculator.h"
+#include "MoveCache.h"
 #include "Segment.h"
 #include "Solution.h"
+#include "ThreadPool.h"
+#include "TopMoves.h"
+#include "TourModifier.h"
+#include "TourState.h"
 #include "VMove.h"
 #include "check.h"
 #include "constants.h"
 #include "point_quadtree/Domain.h"
-#include "point_quadtree/Node.h"
-#include "point_quadtree/morton_keys.h"
-#include "point_quadtree/point_quadtree.h"
+#include "point_quadtree/Quadtree.h"
+#include "point_quadtree/SegmentState.h"
 #include "primitives.h"
 #include "tour.h"
 
+#include <algorithm> // none_of, remove_if, sort
 #include <array>
+#include <atomic>
+#include <limits> // numeric_limits
+#include <mutex>
 #include <vector>
 
 namespace solver {
 
+template <typename Metric>
+inline primitives::node_id_t get_search_node(primitives::point_id_t i
+    , const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<std::array<primitives::length_t, 2>>& adjacent_lengths
+    , const point_quadtree::SegmentState& segment_state)
+{
+    auto old_segments_length {adjacent_lengths[i][0] + adjacent_lengths[i][1]};
+    return quadtree.expand(quadtree.leaf(i), primitives::to_space(x[i]), primitives::to_space(y[i]), old_segments_length, segment_state);
+}
+
+template <typename Metric>
 inline void update_search_nodes(
-    std::vector<const point_quadtree::Node*>& search_nodes
-    , const std::vector<primitives::space_t>& x
-    , const std::vector<primitives::space_t>& y
-    , const std::vector<const point_quadtree::Node*>& leaf_nodes
-    , const std::vector<std::array<primitives::length_t, 2>>& adjacent_lengths)
+    std::vector<primitives::node_id_t>& search_nodes
+    , const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<std::array<primitives::length_t, 2>>& adjacent_lengths
+    , const point_quadtree::SegmentState& segment_state)
 {
     for (primitives::point_id_t i {0}; i < x.size(); ++i)
     {
-        auto old_segments_length {adjacent_lengths[i][0] + adjacent_lengths[i][1]};
-        search_nodes[i] = {leaf_nodes[i]->expand(x[i], y[i], old_segments_length)};
+        search_nodes[i] = get_search_node(i, x, y, quadtree, adjacent_lengths, segment_state);
     }
 }
 
-inline std::vector<const point_quadtree::Node*> get_search_nodes(
-    const std::vector<primitives::space_t>& x
-    , const std::vector<primitives::space_t>& y
-    , const std::vector<const point_quadtree::Node*>& leaf_nodes
-    , const std::vector<std::array<primitives::length_t, 2>>& adjacent_lengths)
+template <typename Metric>
+inline std::vector<primitives::node_id_t> get_search_nodes(
+    const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<std::array<primitives::length_t, 2>>& adjacent_lengths
+    , const point_quadtree::SegmentState& segment_state)
 {
-    std::vector<const point_quadtree::Node*> search_nodes(x.size(), nullptr);
-    update_search_nodes(search_nodes, x, y, leaf_nodes, adjacent_lengths);
+    std::vector<primitives::node_id_t> search_nodes(x.size(), 0);
+    update_search_nodes(search_nodes, x, y, quadtree, adjacent_lengths, segment_state);
     return search_nodes;
 }
 
-inline VMove find_best_improvement(const std::vector<const point_quadtree::Node*>& search_nodes
+template <typename Metric>
+inline VMove search_point(primitives::point_id_t i
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , primitives::node_id_t search_node
     , const std::vector<primitives::point_id_t>& next
     , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
-    , const DistanceCalculator& dc
+    , const DistanceCalculator<Metric>& dc
+    , const std::vector<primitives::length_t>& next_lengths
+    , const point_quadtree::SegmentState& segment_state
+    , const Segment& permanent_segment = {})
+{
+    auto old_segments_length {next_lengths[i]};
+    if (next[adjacents[i][0]] == i)
+    {
+        old_segments_length += next_lengths[adjacents[i][0]];
+    }
+    else if (next[adjacents[i][1]] == i)
+    {
+        old_segments_length += next_lengths[adjacents[i][1]];
+    }
+    else
+    {
+        std::cout << __func__ << ": error: inconsistency between next and adjacents" << std::endl;
+        std::abort();
+    }
+    return quadtree.search(search_node, i
+        , next, adjacents, dc, next_lengths, old_segments_length, segment_state, permanent_segment);
+}
+
+// Points are searched in parallel chunks; chunk results are reduced in point order,
+//  so the result is the same as a serial search.
+template <typename Metric>
+inline VMove find_best_improvement(const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<primitives::node_id_t>& search_nodes
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+    , const DistanceCalculator<Metric>& dc
+    , const std::vector<primitives::length_t>& next_lengths
+    , const point_quadtree::SegmentState& segment_state
+    , ThreadPool& thread_pool
     , const Segment& permanent_segment = {})
 {
     // call search on each node.
-    const auto next_lengths {tour::compute_next_lengths(next, dc)};
-    VMove best_move;
-    for (primitives::point_id_t i {0}; i < next.size(); ++i)
+    std::vector<VMove> chunk_moves(thread_pool.chunk_count(next.size()));
+    thread_pool.for_each_chunk(next.size(), [&](size_t begin, size_t end, size_t chunk)
     {
-        auto old_segments_length {next_lengths[i]};
-        if (next[adjacents[i][0]] == i)
-        {
-            old_segments_length += next_lengths[adjacents[i][0]];
-        }
-        else if (next[adjacents[i][1]] == i)
+        VMove best_move;
+        for (auto i {static_cast<primitives::point_id_t>(begin)}; i < end; ++i)
         {
-            old_segments_length += next_lengths[adjacents[i][1]];
+            best_move.apply(search_point(i, quadtree, search_nodes[i], next, adjacents, dc, next_lengths, segment_state, permanent_segment));
         }
-        else
-        {
-            std::cout << __func__ << ": error: inconsistency between next and adjacents" << std::endl;
-            std::abort();
-        }
-        if (permanent_segment.length == 0)
+        chunk_moves[chunk] = best_move;
+    });
+    VMove best_move;
+    for (const auto& move : chunk_moves)
+    {
+        best_move.apply(move);
+    }
+    return best_move;
+}
+
+// Returns the best move of every point; points are searched in parallel chunks.
+template <typename Metric>
+inline std::vector<VMove> find_improvements(
+    const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+    , const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<std::array<primitives::length_t, 2>>& segment_lengths
+    , const point_quadtree::SegmentState& segment_state
+    , const DistanceCalculator<Metric>& dc
+    , const std::vector<primitives::length_t>& next_lengths
+    , ThreadPool& thread_pool
+    , const Segment& permanent_segment = {})
+{
+    std::vector<VMove> moves(next.size());
+    thread_pool.for_each_chunk(next.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (auto i {static_cast<primitives::point_id_t>(begin)}; i < end; ++i)
         {
-            const auto move {search_nodes[i]->search(i
-                , next, adjacents, dc, next_lengths, old_segments_length)};
-            best_move.apply(move);
+            const auto search_node {get_search_node(i, x, y, quadtree, segment_lengths, segment_state)};
+            moves[i] = search_point(i, quadtree, search_node, next, adjacents, dc, next_lengths, segment_state, permanent_segment);
         }
-        else
+    });
+    return moves;
+}
+
+// Returns the improvement of move in the current tour, or 0 if it is no longer a valid improving move.
+template <typename Metric>
+inline primitives::length_t current_improvement(const VMove& move
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents
+    , const DistanceCalculator<Metric>& dc
+    , const Segment& permanent_segment = {})
+{
+    const auto i {move.i};
+    const auto j {move.j};
+    if (j == i or next[j] == i)
+    {
+        return 0;
+    }
+    if (permanent_segment.length > 0)
+    {
+        const bool removes_permanent {permanent_segment.same(j, next[j])
+            or permanent_segment.same(i, adjacents[i][0])
+            or permanent_segment.same(i, adjacents[i][1])};
+        if (removes_permanent)
         {
-            const auto move {search_nodes[i]->search(i
-                , next, adjacents, dc, next_lengths, old_segments_length, permanent_segment)};
-            best_move.apply(move);
+            return 0;
         }
     }
-    return best_move;
+    const auto reduction {dc.compute_length(i, adjacents[i][0])
+        + dc.compute_length(i, adjacents[i][1])
+        + dc.compute_length(j, next[j])};
+    const auto new_length {dc.compute_length(i, j)
+        + dc.compute_length(i, next[j])
+        + dc.compute_length(adjacents[i][0], adjacents[i][1])};
+    if (new_length < reduction)
+    {
+        return reduction - new_length;
+    }
+    return 0;
 }
 
+// Points whose adjacent segments are changed by move.
+inline std::array<primitives::point_id_t, 5> affected_points(const VMove& move
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents)
+{
+    return {{move.i, adjacents[move.i][0], adjacents[move.i][1], move.j, next[move.j]}};
+}
+
+template <typename Metric>
 inline std::array<Segment, 3> compute_new_segments(const VMove& move
-    , const DistanceCalculator& dc
+    , const DistanceCalculator<Metric>& dc
     , const std::vector<primitives::point_id_t>& next
     , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents)
 {
@@ -97,8 +214,9 @@ inline std::array<Segment, 3> compute_new_segments(const VMove& move
     }};
 }
 
+template <typename Metric>
 inline std::array<Segment, 3> compute_old_segments(const VMove& move
-    , const DistanceCalculator& dc
+    , const DistanceCalculator<Metric>& dc
     , const std::vector<primitives::point_id_t>& next
     , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents)
 {
@@ -163,108 +281,240 @@ inline void update_segment_lengths(const std::array<Segment, 3>& old_segments
     }
 }
 
-inline void apply_move(
-    std::vector<const point_quadtree::Node*>& search_nodes
-    , std::vector<std::array<primitives::length_t, 2>>& segment_lengths
-    , point_quadtree::Node& root
-    , std::vector<std::array<primitives::point_id_t, 2>>& adjacents
-    , std::vector<primitives::point_id_t>& next
+// Only state attached to the endpoints of the old and new segments is updated.
+// Search nodes are not stored; they are found from the current tree when a point is searched.
+template <typename Metric>
+inline void apply_move(TourState& state
+    , const point_quadtree::Quadtree<Metric>& quadtree
     , const VMove& move
-    , const std::vector<primitives::morton_key_t>& morton_keys
-    , const std::vector<const point_quadtree::Node*>& leaf_nodes
-    , const std::vector<primitives::space_t>& x
-    , const std::vector<primitives::space_t>& y
-    , const DistanceCalculator& dc)
+    , const DistanceCalculator<Metric>& dc)
 {
+    const auto& next {state.tour_modifier.next()};
+    const auto& adjacents {state.tour_modifier.adjacents()};
     const auto old_segments {compute_old_segments(move, dc, next, adjacents)};
     for (const auto& s : old_segments)
     {
-        const auto segment_insertion_path {point_quadtree::morton_keys::segment_insertion_path(
-            morton_keys[s.min], morton_keys[s.max])};
-        root.remove_segment(std::cbegin(segment_insertion_path), std::cend(segment_insertion_path), s.length);
+        quadtree.remove_segment(s, state.segment_state);
+        state.length -= s.length;
     }
     const auto new_segments {compute_new_segments(move, dc, next, adjacents)};
     for (const auto& s : new_segments)
     {
-        const auto segment_insertion_path {point_quadtree::morton_keys::segment_insertion_path(
-            morton_keys[s.min], morton_keys[s.max])};
-        root.add_segment(std::cbegin(segment_insertion_path), std::cend(segment_insertion_path), s.length);
+        quadtree.add_segment(s, state.segment_state);
+        state.length += s.length;
+    }
+    update_segment_lengths(old_segments, new_segments, state.segment_lengths);
+    const auto prev {state.tour_modifier.prev(move.i)};
+    if (state.journal)
+    {
+        // moving i back between prev and its old next, which will be next[prev] after this move.
+        state.undo_log.push_back({move.i, prev});
+    }
+    state.tour_modifier.move(move);
+    for (auto p : {prev, move.j, move.i})
+    {
+        state.next_lengths[p] = dc.compute_length(p, next[p]);
+    }
+}
+
+// Undoes all moves in the undo log, most recent first, and clears it.
+template <typename Metric>
+inline void rollback(TourState& state
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const DistanceCalculator<Metric>& dc)
+{
+    const bool journal {state.journal};
+    state.journal = false;
+    for (auto it {std::crbegin(state.undo_log)}; it != std::crend(state.undo_log); ++it)
+    {
+        apply_move(state, quadtree, *it, dc);
+    }
+    state.undo_log.clear();
+    state.journal = journal;
+}
+
+// Hill climbs from the current state. points are searched first; all points are searched
+//  whenever no cached improving moves remain, which also confirms the local optimum.
+// Stops early once budget times out, if given; returns false if so.
+template <typename Metric>
+inline bool climb(TourState& state
+    , const std::vector<primitives::point_id_t>& points
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const DistanceCalculator<Metric>& dc
+    , ThreadPool& thread_pool
+    , const Segment& permanent_segment = {}
+    , const Budget* budget = nullptr)
+{
+    const auto& next {state.tour_modifier.next()};
+    const auto& adjacents {state.tour_modifier.adjacents()};
+
+    // Only points affected by a move are searched again.
+    MoveCache move_cache(next.size());
+    auto update_move_cache = [&](primitives::point_id_t i)
+    {
+        const auto search_node {get_search_node(i, x, y, quadtree, state.segment_lengths, state.segment_state)};
+        move_cache.update(i, search_point(i, quadtree, search_node, next, adjacents, dc, state.next_lengths, state.segment_state, permanent_segment));
+    };
+    for (auto p : points)
+    {
+        update_move_cache(p);
+    }
+    int iteration {0};
+    while (true)
+    {
+        if (budget and budget->timed_out())
+        {
+            return false;
+        }
+        auto move {move_cache.pop()};
+        if (move.improvement == 0)
+        {
+            const auto moves {find_improvements(next, adjacents, x, y, quadtree
+                , state.segment_lengths, state.segment_state, dc, state.next_lengths, thread_pool, permanent_segment)};
+            for (primitives::point_id_t i {0}; i < next.size(); ++i)
+            {
+                move_cache.update(i, moves[i]);
+            }
+            move = move_cache.pop();
+        }
+        if (move.improvement == 0)
+        {
+            return true;
+        }
+        if (current_improvement(move, next, adjacents, dc, permanent_segment) != move.improvement)
+        {
+            update_move_cache(move.i);
+            continue;
+        }
+
+        const auto affected {affected_points(move, next, adjacents)};
+        apply_move(state, quadtree, move, dc);
+        for (auto p : affected)
+        {
+            update_move_cache(p);
+        }
+        ++iteration;
+        if (constants::verify)
+        {
+            tour::verify(state.tour_modifier.current_tour(), not state.quiet);
+        }
+        if (constants::print_iterations and not state.quiet)
+        {
+            std::cout << "Iteration: " << iteration << " length: " << state.length << std::endl;
+        }
     }
-    update_segment_lengths(old_segments, new_segments, segment_lengths);
-    update_search_nodes(search_nodes, x, y, leaf_nodes, segment_lengths);
-    tour::apply_move(move, adjacents, next);
 }
 
+template <typename Metric>
 inline std::vector<primitives::point_id_t> hill_climb(
     const std::vector<primitives::point_id_t>& ordered_points
-    , const std::vector<primitives::morton_key_t>& morton_keys
-    , point_quadtree::Node& root
-    , const std::vector<const point_quadtree::Node*>& leaf_nodes
-    , const std::vector<primitives::space_t>& x
-    , const std::vector<primitives::space_t>& y
-    , const DistanceCalculator& dc
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const DistanceCalculator<Metric>& dc
+    , ThreadPool& thread_pool
     , const Segment& permanent_segment = {})
 {
-    auto adjacents {tour::compute_adjacents(ordered_points)};
-    auto next {tour::compute_next(adjacents)};
-    auto segments {tour::compute_segments(next, dc)};
-    root.reset_segments();
-    for (const auto& s : segments)
+    TourState state(ordered_points, quadtree, dc);
+    climb(state, {}, quadtree, x, y, dc, thread_pool, permanent_segment);
+    return state.tour_modifier.current_tour();
+}
+
+// Greedily selects moves in order of improvement such that no two moves share an affected point.
+// This is Connection::compatible extended to all points of a move; moves that are disjoint
+//  in this sense do not change each other's segments, so they can be applied in any order.
+inline std::vector<VMove> select_compatible_moves(std::vector<VMove> moves
+    , const std::vector<primitives::point_id_t>& next
+    , const std::vector<std::array<primitives::point_id_t, 2>>& adjacents)
+{
+    moves.erase(std::remove_if(std::begin(moves), std::end(moves)
+        , [](const VMove& move) { return move.improvement == 0; }), std::end(moves));
+    std::sort(std::begin(moves), std::end(moves)
+        , [](const VMove& lhs, const VMove& rhs) { return VMove::Compare()(rhs, lhs); });
+    std::vector<bool> touched(next.size(), false);
+    std::vector<VMove> selected;
+    for (const auto& move : moves)
     {
-        root.add_segment(s, morton_keys);
+        const auto affected {affected_points(move, next, adjacents)};
+        const bool compatible {std::none_of(std::cbegin(affected), std::cend(affected)
+            , [&touched](primitives::point_id_t p) { return touched[p]; })};
+        if (compatible)
+        {
+            for (auto p : affected)
+            {
+                touched[p] = true;
+            }
+            selected.push_back(move);
+        }
     }
-    auto segment_lengths {tour::compute_adjacent_lengths(adjacents, dc)};
-    auto search_nodes {get_search_nodes(x, y, leaf_nodes, segment_lengths)};
+    return selected;
+}
+
+// Like hill_climb, but every search pass applies all compatible improving moves it finds.
+template <typename Metric>
+inline std::vector<primitives::point_id_t> batch_hill_climb(
+    const std::vector<primitives::point_id_t>& ordered_points
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const DistanceCalculator<Metric>& dc
+    , ThreadPool& thread_pool)
+{
+    TourState state(ordered_points, quadtree, dc);
+    const auto& next {state.tour_modifier.next()};
+    const auto& adjacents {state.tour_modifier.adjacents()};
 
     int iteration {0};
+    int pass {0};
     while (true)
     {
-        const auto best_move {find_best_improvement(search_nodes, next, adjacents, dc, permanent_segment)};
-        if (best_move.improvement == 0)
+        const auto moves {select_compatible_moves(find_improvements(next, adjacents, x, y, quadtree
+            , state.segment_lengths, state.segment_state, dc, state.next_lengths, thread_pool), next, adjacents)};
+        if (moves.empty())
         {
             break;
         }
-
-        apply_move(search_nodes, segment_lengths, root, adjacents, next, best_move, morton_keys, leaf_nodes, x, y, dc);
-        ++iteration;
-        if (constants::verify)
+        for (const auto& move : moves)
         {
-            tour::verify(tour::compute_ordered_points(next));
+            apply_move(state, quadtree, move, dc);
         }
+        iteration += moves.size();
+        ++pass;
+        // moves were selected against the tour before the pass, so check that it is still one cycle;
+        //  one walk of the tour is small next to the full search of the pass.
+        tour::verify(state.tour_modifier.current_tour(), false);
         if (constants::print_iterations)
         {
-            std::cout << "Iteration: " << iteration << " length: " << tour::compute_length(tour::compute_ordered_points(next), dc) << std::endl;
+            std::cout << "Pass: " << pass << " moves: " << moves.size()
+                << " iterations: " << iteration << " length: " << state.length << std::endl;
         }
     }
-    return tour::compute_ordered_points(next);
+    return state.tour_modifier.current_tour();
 }
 
+template <typename Metric>
 inline std::vector<VMove> find_perturbations(
     const std::vector<primitives::point_id_t>& ordered_points
-    , const std::vector<primitives::morton_key_t>& morton_keys
-    , point_quadtree::Node& root
-    , const std::vector<const point_quadtree::Node*>& leaf_nodes
-    , const std::vector<primitives::space_t>& x
-    , const std::vector<primitives::space_t>& y
-    , const DistanceCalculator& dc)
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const DistanceCalculator<Metric>& dc
+    , size_t max_perturbations)
 {
-    auto adjacents {tour::compute_adjacents(ordered_points)};
-    auto next {tour::compute_next(adjacents)};
-    auto segments {tour::compute_segments(next, dc)};
-    root.reset_segments();
-    for (const auto& s : segments)
-    {
-        root.add_segment(s, morton_keys);
-    }
-    const auto segment_lengths {tour::compute_adjacent_lengths(adjacents, dc)};
-    const auto search_nodes {get_search_nodes(x, y, leaf_nodes, segment_lengths)};
+    const TourState state(ordered_points, quadtree, dc);
+    const auto& next {state.tour_modifier.next()};
+    const auto& adjacents {state.tour_modifier.adjacents()};
+    const auto& segment_lengths {state.segment_lengths};
+    const auto search_nodes {get_search_nodes(x, y, quadtree, segment_lengths, state.segment_state)};
 
     // call search on each node.
-    std::vector<VMove> perturbations;
-    const auto next_lengths {tour::compute_next_lengths(next, dc)};
+    TopMoves perturbations(max_perturbations);
+    const auto& next_lengths {state.next_lengths};
     for (primitives::point_id_t i {0}; i < x.size(); ++i)
     {
-        search_nodes[i]->search_perturbation(i
+        quadtree.search_perturbation(search_nodes[i], i
             , next
             , next_lengths
             , dc
@@ -272,32 +522,47 @@ inline std::vector<VMove> find_perturbations(
             , dc.compute_length(adjacents[i][0], adjacents[i][1])
             , perturbations);
     }
-    return perturbations;
+    return perturbations.take();
 }
 
+// Perturbations are evaluated concurrently by thread_pool workers. Each worker owns a TourState,
+//  including a replica of the segment state; the quadtree is shared and read-only.
+// A worker applies a perturbation and hill climbs to a local optimum, starting from the points
+//  the perturbation affects, then rolls its state back through the undo log,
+//  so no state is rebuilt between perturbations.
+// Only the max_perturbations candidates with the greatest improvement are kept, and they are
+//  evaluated best first until they run out or budget is exhausted.
+// Trials still climbing when budget times out are stopped and discarded.
+// With first improvement, workers skip perturbations ordered after the earliest improving one found so far,
+//  so the result is the same as evaluating perturbations in order.
+// Returns an empty tour if no perturbation leads to an improvement.
+template <typename Metric>
 inline std::vector<primitives::point_id_t> perturbed_hill_climb(
     const std::vector<primitives::point_id_t>& ordered_points
-    , const std::vector<primitives::morton_key_t>& morton_keys
-    , point_quadtree::Node& root
-    , const std::vector<const point_quadtree::Node*>& leaf_nodes
-    , const std::vector<primitives::space_t>& x
-    , const std::vector<primitives::space_t>& y
-    , const DistanceCalculator& dc)
+    , const point_quadtree::Quadtree<Metric>& quadtree
+    , const std::vector<primitives::coordinate_t>& x
+    , const std::vector<primitives::coordinate_t>& y
+    , const DistanceCalculator<Metric>& dc
+    , ThreadPool& thread_pool
+    , Budget& budget
+    , size_t max_perturbations
+    , bool first_improvement = true)
 {
-    auto original_adjacents {tour::compute_adjacents(ordered_points)};
-    auto original_next {tour::compute_next(original_adjacents)};
-    auto segment_lengths {tour::compute_adjacent_lengths(original_adjacents, dc)};
+    const TourState original_state(ordered_points, quadtree, dc);
+    const auto& original_adjacents {original_state.tour_modifier.adjacents()};
+    const auto& original_next {original_state.tour_modifier.next()};
+    const auto& segment_lengths {original_state.segment_lengths};
 
     // TODO: top-down root search instead of predetermined search nodes.
-    std::vector<const point_quadtree::Node*> perturbation_search_nodes(x.size(), nullptr);
+    std::vector<primitives::node_id_t> perturbation_search_nodes(x.size(), 0);
     for (primitives::point_id_t i {0}; i < x.size(); ++i)
     {
         auto min_segments_length {std::min(segment_lengths[i][0], segment_lengths[i][1])};
-        perturbation_search_nodes[i] = {leaf_nodes[i]->expand_simple(x[i], y[i], min_segments_length)};
+        perturbation_search_nodes[i] = quadtree.expand_simple(quadtree.leaf(i), primitives::to_space(x[i]), primitives::to_space(y[i]), min_segments_length, original_state.segment_state);
     }
 
-    std::vector<VMove> perturbations;
-    const auto next_lengths {tour::compute_next_lengths(original_next, dc)};
+    TopMoves top_perturbations(max_perturbations);
+    const auto& next_lengths {original_state.next_lengths};
     for (primitives::point_id_t i {0}; i < x.size(); ++i)
     {
         const auto max_adjacent_length {std::max(segment_lengths[i][0], segment_lengths[i][1])};
@@ -310,60 +575,107 @@ inline std::vector<primitives::point_id_t> perturbed_hill_climb(
         {
             continue;
         }
-        perturbation_search_nodes[i]->search_perturbation_lax(i
+        quadtree.search_perturbation_lax(perturbation_search_nodes[i], i
             , original_next
             , next_lengths
             , dc
             , max_adjacent_length
             , dc.compute_length(original_adjacents[i][0], original_adjacents[i][1])
-            , perturbations);
+            , top_perturbations);
     }
+    std::cout << "total perturbations: " << top_perturbations.pushed()
+        << " kept: " << top_perturbations.size() << std::endl;
+    const auto perturbations {top_perturbations.take()};
 
+    constexpr auto no_perturbation {std::numeric_limits<size_t>::max()};
+    std::atomic<size_t> next_perturbation {0};
+    std::atomic<size_t> perturbation_count {0};
+    std::atomic<size_t> first_improving {no_perturbation}; // only used for first improvement.
+    std::mutex best_mutex;
     std::vector<primitives::point_id_t> best_solution;
-    auto best_length {tour::compute_length(ordered_points, dc)};
-    std::cout << "total perturbations: " << perturbations.size() << std::endl;
-    int perturbation_count {0};
-    for (const auto& perturbation : perturbations)
-    {
-        ++perturbation_count;
-        std::cout << "attempting perturbation " << perturbation_count << " of " << perturbations.size() << std::endl;
-        const auto perturbed_points {tour::perturb(perturbation, ordered_points)};
-        const auto min_old_length
+    const auto original_length {original_state.length};
+    auto best_length {original_length};
+    auto best_perturbation {no_perturbation};
+    const auto worker_count {thread_pool.size()};
+    thread_pool.for_each_chunk(worker_count, [&](size_t, size_t, size_t)
+    {
+        auto state {original_state};
+        state.journal = true;
+        state.quiet = true;
+        ThreadPool worker_thread_pool(1);
+        for (auto p {next_perturbation++}; p < perturbations.size(); p = next_perturbation++)
         {
-            std::min(
+            if (first_improvement and p > first_improving)
+            {
+                break;
+            }
+            if (not budget.spend())
+            {
+                break;
+            }
+            ++perturbation_count;
+            const auto& perturbation {perturbations[p]};
+            if (constants::verbose)
+            {
+                std::lock_guard<std::mutex> lock(best_mutex);
+                std::cout << "attempting perturbation " << p + 1 << " of " << perturbations.size() << std::endl;
+            }
+            const auto min_old_length
+            {
+                std::min(
+                    {
+                        next_lengths[perturbation.j]
+                        , segment_lengths[perturbation.i][0]
+                        , segment_lengths[perturbation.i][1]
+                    }
+                )
+            };
+            const std::array<Segment, 3> permanent_segments
+            {{
+                {perturbation.i, perturbation.j, dc}
+                , {perturbation.i, original_next[perturbation.j], dc}
+                , {original_adjacents[perturbation.i][0], original_adjacents[perturbation.i][1], dc}
+            }};
+            for (const auto& s : permanent_segments)
+            {
+                if (s.length > min_old_length)
                 {
-                    next_lengths[perturbation.j]
-                    , segment_lengths[perturbation.i][0]
-                    , segment_lengths[perturbation.i][1]
+                    continue;
                 }
-            )
-        };
-        const std::array<Segment, 3> permanent_segments
-        {{
-            {perturbation.i, perturbation.j, dc}
-            , {perturbation.i, original_next[perturbation.j], dc}
-            , {original_adjacents[perturbation.i][0], original_adjacents[perturbation.i][1], dc}
-        }};
-        for (const auto& s : permanent_segments)
-        {
-            if (s.length <= min_old_length)
-            {
-                auto solution = hill_climb(perturbed_points, morton_keys, root, leaf_nodes, x, y, dc, s);
+                const auto points {affected_points(perturbation, state.tour_modifier.next(), state.tour_modifier.adjacents())};
+                const std::vector<primitives::point_id_t> climb_points(std::cbegin(points), std::cend(points));
+                apply_move(state, quadtree, perturbation, dc);
+                const bool converged {climb(state, climb_points, quadtree, x, y, dc, worker_thread_pool, s, &budget)
+                    and climb(state, {}, quadtree, x, y, dc, worker_thread_pool, {}, &budget)};
+                const auto length {state.length};
+                std::vector<primitives::point_id_t> solution;
+                if (converged and length < original_length)
+                {
+                    solution = state.tour_modifier.current_tour();
+                }
+                rollback(state, quadtree, dc);
                 if (solution.empty())
                 {
                     continue;
                 }
-                solution = hill_climb(solution, morton_keys, root, leaf_nodes, x, y, dc);
-                auto length {tour::compute_length(solution, dc)};
-                if (length < best_length)
+                std::lock_guard<std::mutex> lock(best_mutex);
+                const bool best {first_improvement
+                    ? p < best_perturbation
+                    : length < best_length or (length == best_length and p < best_perturbation)};
+                if (best)
                 {
                     best_solution = solution;
                     best_length = length;
-                    return best_solution; // first_improvement.
+                    best_perturbation = p;
+                    if (first_improvement)
+                    {
+                        first_improving = p;
+                        break;
+                    }
                 }
             }
         }
-    }
+    });
     std::cout << "perturbations explored: " << perturbation_count << std::endl;
     return best_solution;
 }
@@ -1,42 +1,197 @@
-
+#include "Budget.h"
 #include "DistanceCalculator.h"
+#include "ThreadPool.h"
 #include "TourModifier.h"
 #include "check.h"
+#include "construct.h"
 #include "fileio/PointSet.h"
 #include "fileio/fileio.h"
+#include "metric.h"
+#include "options.h"
+#include "point_quadtree/CandidateQuadtree.h"
 #include "point_quadtree/Domain.h"
-#include "point_quadtree/Node.h"
+#include "point_quadtree/LinearQuadtree.h"
+#include "point_quadtree/PointerQuadtree.h"
+#include "point_quadtree/hilbert_keys.h"
 #include "point_quadtree/morton_keys.h"
-#include "point_quadtree/point_quadtree.h"
 #include "primitives.h"
 #include "solver.h"
 
+#include <cstdlib> // abort
 #include <iostream>
+#include <memory>
+#include <utility> // move
+#include <vector>
 
-int main(int argc, const char** argv)
+// Renumbers points in curve order, so that the per-point arrays of the search
+//  (coordinates, next, adjacents, next_lengths) are accessed near in memory for points near in space.
+inline void renumber(const options::Options& options, fileio::PointSet& point_set, ThreadPool& thread_pool)
 {
-    if (argc < 2)
+    const point_quadtree::Domain domain(point_set.x(), point_set.y());
+    auto keys {point_quadtree::morton_keys::compute_point_morton_keys(point_set.x(), point_set.y(), domain, thread_pool)};
+    if (options.renumber == options::Renumber::hilbert)
     {
-        std::cout << "Arguments: point_set_file_path optional_tour_file_path" << std::endl;
-        return 0;
+        keys = point_quadtree::hilbert_keys::compute_point_hilbert_keys(keys, thread_pool);
     }
-    // Read input files.
-    const fileio::PointSet point_set(argv[1]);
-    const auto initial_tour = fileio::initial_tour(argc, argv, point_set.count());
+    point_set.renumber(construct::space_filling_curve(keys, thread_pool));
+}
+
+// options::DistanceCache::automatic picks the full table up to this many points (64 MB of table).
+constexpr primitives::point_id_t max_table_points {4096};
+
+template <typename Metric>
+void print_cache_statistics(const DistanceCalculator<Metric>& dc)
+{
+    if constexpr (metric::cache<Metric> != metric::DistanceCache::none)
+    {
+        const auto lookups {dc.hits() + dc.misses()};
+        std::cout << "distance cache: " << dc.hits() << " hits, " << dc.misses() << " misses";
+        if (lookups > 0)
+        {
+            std::cout << " (" << 100.0 * static_cast<double>(dc.hits()) / static_cast<double>(lookups) << "% hit rate)";
+        }
+        std::cout << std::endl;
+    }
+}
 
+// Everything that computes lengths is instantiated for the edge weight type Metric.
+template <typename Metric>
+int run(const options::Options& options, const fileio::PointSet& point_set, ThreadPool& thread_pool)
+{
     // Initialize distance table.
-    DistanceCalculator dc(point_set.x(), point_set.y());
+    DistanceCalculator<Metric> dc(point_set.x(), point_set.y(), options.cache_entries);
     point_quadtree::Domain domain(point_set.x(), point_set.y());
+    const auto morton_keys {point_quadtree::morton_keys::compute_point_morton_keys(point_set.x(), point_set.y(), domain, thread_pool)};
+    // with --validate, lengths are also reported as a build with double coordinates would compute them.
+    auto validate = [&](const std::vector<primitives::point_id_t>& tour, primitives::length_t length)
+    {
+        if (options.validate)
+        {
+            const auto exact_length {tour::compute_exact_length<Metric>(tour, point_set.exact_x(), point_set.exact_y())};
+            std::cout << "    with double coordinates: " << exact_length
+                << " (difference: " << static_cast<double>(length) - static_cast<double>(exact_length) << ")" << std::endl;
+        }
+    };
+    std::unique_ptr<point_quadtree::Quadtree<Metric>> quadtree;
+    if (options.tree == options::Tree::linear)
+    {
+        quadtree = std::make_unique<point_quadtree::LinearQuadtree<Metric>>(morton_keys, domain, options.leaf_capacity, thread_pool);
+    }
+    else
+    {
+        quadtree = std::make_unique<point_quadtree::PointerQuadtree<Metric>>(morton_keys, domain, options.leaf_capacity, thread_pool);
+    }
+    if (options.search == options::Search::candidates)
+    {
+        quadtree = std::make_unique<point_quadtree::CandidateQuadtree<Metric>>(std::move(quadtree)
+            , dc, point_set.count(), options.candidates, thread_pool);
+    }
+
+    std::vector<primitives::point_id_t> initial_tour;
+    if (not options.tour_file_path.empty() or options.init == options::Init::identity)
+    {
+        initial_tour = point_set.from_file_ids(fileio::initial_tour(options.tour_file_path, point_set.count()));
+    }
+    else if (options.init == options::Init::nearest_neighbour)
+    {
+        initial_tour = construct::nearest_neighbour(*quadtree, dc, point_set.count());
+    }
+    else if (options.init == options::Init::greedy)
+    {
+        initial_tour = construct::greedy(*quadtree, dc, point_set.count(), thread_pool);
+    }
+    else if (options.curve == options::Curve::morton)
+    {
+        initial_tour = construct::space_filling_curve(morton_keys, thread_pool);
+    }
+    else
+    {
+        initial_tour = construct::space_filling_curve(
+            point_quadtree::hilbert_keys::compute_point_hilbert_keys(morton_keys, thread_pool), thread_pool);
+    }
     TourModifier tour_modifier(initial_tour);
     const auto initial_tour_length = tour_modifier.current_length(dc);
     std::cout << "Initial tour length: " << initial_tour_length << std::endl;
+    validate(initial_tour, initial_tour_length);
 
-    const auto morton_keys {point_quadtree::morton_keys::compute_point_morton_keys(point_set.x(), point_set.y(), domain)};
-    point_quadtree::Node root(nullptr, domain, 0, 0, 0);
-    const auto leaf_nodes {point_quadtree::initialize_points(root, morton_keys, domain)};
-
-    auto solution {solver::hill_climb(tour_modifier.current_tour()
-        , morton_keys, root, leaf_nodes, point_set.x(), point_set.y(), dc)};
-    std::cout << "local optimum: " << tour::compute_length(solution, dc) << std::endl;
+    auto solution {options.batch
+        ? solver::batch_hill_climb(tour_modifier.current_tour()
+            , *quadtree, point_set.x(), point_set.y(), dc, thread_pool)
+        : solver::hill_climb(tour_modifier.current_tour()
+            , *quadtree, point_set.x(), point_set.y(), dc, thread_pool)};
+    const auto local_optimum_length {tour::compute_length(solution, dc)};
+    std::cout << "local optimum: " << local_optimum_length << std::endl;
+    validate(solution, local_optimum_length);
+    print_cache_statistics(dc);
+    Budget budget(options.time_limit, options.max_evaluations);
+    while (options.perturbation != options::Perturbation::none and not budget.exhausted())
+    {
+        const auto perturbed_solution {solver::perturbed_hill_climb(solution
+            , *quadtree, point_set.x(), point_set.y(), dc, thread_pool
+            , budget, options.max_perturbations
+            , options.perturbation == options::Perturbation::first_improvement)};
+        if (perturbed_solution.empty())
+        {
+            break;
+        }
+        solution = perturbed_solution;
+        const auto perturbed_length {tour::compute_length(solution, dc)};
+        std::cout << "perturbed local optimum: " << perturbed_length << std::endl;
+        validate(solution, perturbed_length);
+        print_cache_statistics(dc);
+    }
+    if (not options.output_file_path.empty())
+    {
+        fileio::write_ordered_points(point_set.to_file_ids(solution), options.output_file_path);
+    }
     return 0;
 }
+
+// The distance cache is part of the metric policy, so that uncached length computations have no cache checks.
+template <typename Metric>
+int run_cached(const options::Options& options, const fileio::PointSet& point_set, ThreadPool& thread_pool)
+{
+    switch (options.distance_cache)
+    {
+        case options::DistanceCache::table: return run<metric::Table<Metric>>(options, point_set, thread_pool);
+        case options::DistanceCache::hashed: return run<metric::Hashed<Metric>>(options, point_set, thread_pool);
+        case options::DistanceCache::automatic:
+            return point_set.count() <= max_table_points
+                ? run<metric::Table<Metric>>(options, point_set, thread_pool)
+                : run<metric::Hashed<Metric>>(options, point_set, thread_pool);
+        default: return run<Metric>(options, point_set, thread_pool);
+    }
+}
+
+int main(int argc, const char** argv)
+{
+    const auto options {options::parse(argc, argv)};
+    ThreadPool thread_pool(options.threads);
+
+    // Read input files.
+    fileio::PointSet point_set(options.point_set_file_path, options.validate);
+    if (options.renumber != options::Renumber::none)
+    {
+        renumber(options, point_set, thread_pool);
+    }
+
+    const auto& edge_weight_type {point_set.edge_weight_type()};
+    if (edge_weight_type == "EUC_2D")
+    {
+        return run_cached<metric::Euc2d>(options, point_set, thread_pool);
+    }
+    if (edge_weight_type == "CEIL_2D")
+    {
+        return run_cached<metric::Ceil2d>(options, point_set, thread_pool);
+    }
+    if (edge_weight_type == "ATT")
+    {
+        return run_cached<metric::Att>(options, point_set, thread_pool);
+    }
+    if (edge_weight_type == "GEO")
+    {
+        return run_cached<metric::Geo>(options, point_set, thread_pool);
+    }
+    std::cout << __func__ << ": error: unsupported edge weight type: " << edge_weight_type << std::endl;
+    std::abort();
+}